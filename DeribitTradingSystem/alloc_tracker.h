@@ -0,0 +1,252 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Subsystems heap usage is attributed to
+enum class AllocTag : uint8_t {
+    Other,
+    Parser,
+    Books,
+    Rest,
+    WebSocket
+};
+constexpr size_t kAllocTagCount = 5;
+
+inline const char* allocTagName(AllocTag tag) {
+    switch (tag) {
+        case AllocTag::Other: return "other";
+        case AllocTag::Parser: return "parser";
+        case AllocTag::Books: return "books";
+        case AllocTag::Rest: return "rest";
+        case AllocTag::WebSocket: return "websocket";
+    }
+    return "unknown";
+}
+
+struct AllocStats {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytesAllocated = 0;
+    int64_t liveBytes = 0;          // allocated under this tag, not yet freed
+    uint64_t hotPathAllocations = 0; // made inside a HotPathScope
+    uint64_t hotPathBytes = 0;
+};
+
+// --------------------------------------------------------------------
+// AllocTracker: per-subsystem heap accounting through global operator
+// new/delete hooks
+//   - Opt-in at build time: compile with -DDERIBIT_TRACK_ALLOCATIONS. The
+//     hooks themselves are emitted by the one translation unit that
+//     defines DERIBIT_ALLOCATION_HOOKS_IMPLEMENTATION before including
+//     this header (main.cpp). Without the flag enabled() is false and the
+//     scopes below are a thread-local store each.
+//   - The calling thread's AllocScope decides the tag. Each block carries
+//     a 16-byte header with its size and tag, so a free is credited to
+//     the subsystem that allocated it, whichever thread frees it.
+//   - Allocations made inside a HotPathScope are counted separately; in
+//     steady state those counters should not move.
+// --------------------------------------------------------------------
+class AllocTracker {
+private:
+    struct alignas(64) TagCounters {
+        std::atomic<uint64_t> allocations{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> bytesAllocated{0};
+        std::atomic<int64_t> liveBytes{0};
+        std::atomic<uint64_t> hotPathAllocations{0};
+        std::atomic<uint64_t> hotPathBytes{0};
+    };
+
+    static std::array<TagCounters, kAllocTagCount>& counters() {
+        static std::array<TagCounters, kAllocTagCount> instance;
+        return instance;
+    }
+
+    static std::atomic<int64_t>& totalLive() {
+        static std::atomic<int64_t> instance{0};
+        return instance;
+    }
+
+    static std::atomic<int64_t>& peakLive() {
+        static std::atomic<int64_t> instance{0};
+        return instance;
+    }
+
+public:
+    // Trivially constructed, so usable from inside operator new
+    struct ThreadState {
+        AllocTag tag;
+        bool hotPath;
+    };
+
+    static ThreadState& threadState() {
+        static thread_local ThreadState state{AllocTag::Other, false};
+        return state;
+    }
+
+    static constexpr bool enabled() {
+#ifdef DERIBIT_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Called by the hooks only
+    static void onAllocate(AllocTag tag, size_t size, bool hotPath) {
+        TagCounters& c = counters()[static_cast<size_t>(tag)];
+        c.allocations.fetch_add(1, std::memory_order_relaxed);
+        c.bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+        c.liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+        if (hotPath) {
+            c.hotPathAllocations.fetch_add(1, std::memory_order_relaxed);
+            c.hotPathBytes.fetch_add(size, std::memory_order_relaxed);
+        }
+        int64_t live = totalLive().fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed) +
+                       static_cast<int64_t>(size);
+        int64_t peak = peakLive().load(std::memory_order_relaxed);
+        while (live > peak && !peakLive().compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+
+    static void onFree(AllocTag tag, size_t size) {
+        TagCounters& c = counters()[static_cast<size_t>(tag)];
+        c.frees.fetch_add(1, std::memory_order_relaxed);
+        c.liveBytes.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+        totalLive().fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+    }
+
+    static AllocStats stats(AllocTag tag) {
+        const TagCounters& c = counters()[static_cast<size_t>(tag)];
+        AllocStats s;
+        s.allocations = c.allocations.load(std::memory_order_relaxed);
+        s.frees = c.frees.load(std::memory_order_relaxed);
+        s.bytesAllocated = c.bytesAllocated.load(std::memory_order_relaxed);
+        s.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+        s.hotPathAllocations = c.hotPathAllocations.load(std::memory_order_relaxed);
+        s.hotPathBytes = c.hotPathBytes.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    static int64_t liveBytes() {
+        return totalLive().load(std::memory_order_relaxed);
+    }
+
+    static int64_t peakLiveBytes() {
+        return peakLive().load(std::memory_order_relaxed);
+    }
+};
+
+// Attributes the calling thread's allocations to 'tag' for its scope
+class AllocScope {
+private:
+    AllocTag previous;
+
+public:
+    explicit AllocScope(AllocTag tag) : previous(AllocTracker::threadState().tag) {
+        AllocTracker::threadState().tag = tag;
+    }
+
+    ~AllocScope() {
+        AllocTracker::threadState().tag = previous;
+    }
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+};
+
+// Marks the calling thread as on the hot path for its scope; a scope
+// held for a thread's whole run marks the thread itself
+class HotPathScope {
+private:
+    bool previous;
+
+public:
+    HotPathScope() : previous(AllocTracker::threadState().hotPath) {
+        AllocTracker::threadState().hotPath = true;
+    }
+
+    ~HotPathScope() {
+        AllocTracker::threadState().hotPath = previous;
+    }
+
+    HotPathScope(const HotPathScope&) = delete;
+    HotPathScope& operator=(const HotPathScope&) = delete;
+};
+
+#endif // ALLOC_TRACKER_H
+
+// Outside the include guard so the implementing file can include this
+// header again after other headers already pulled it in
+#if defined(DERIBIT_TRACK_ALLOCATIONS) && defined(DERIBIT_ALLOCATION_HOOKS_IMPLEMENTATION) && \
+    !defined(ALLOC_TRACKER_HOOKS_DEFINED)
+#define ALLOC_TRACKER_HOOKS_DEFINED
+
+namespace alloc_hooks {
+
+// Keeps the default new alignment (16 on x86-64) for the caller's block
+constexpr size_t kHeaderSize = 16;
+
+struct Header {
+    size_t size;
+    AllocTag tag;
+};
+static_assert(sizeof(Header) <= kHeaderSize, "allocation header too large");
+
+inline void* allocate(size_t size) {
+    void* raw = std::malloc(size + kHeaderSize);
+    if (!raw) {
+        return nullptr;
+    }
+    auto& state = AllocTracker::threadState();
+    Header* header = static_cast<Header*>(raw);
+    header->size = size;
+    header->tag = state.tag;
+    AllocTracker::onAllocate(state.tag, size, state.hotPath);
+    return static_cast<char*>(raw) + kHeaderSize;
+}
+
+inline void* allocateOrThrow(size_t size) {
+    void* p = allocate(size);
+    while (!p) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+        p = allocate(size);
+    }
+    return p;
+}
+
+inline void release(void* p) {
+    if (!p) {
+        return;
+    }
+    Header* header = reinterpret_cast<Header*>(static_cast<char*>(p) - kHeaderSize);
+    AllocTracker::onFree(header->tag, header->size);
+    std::free(header);
+}
+
+} // namespace alloc_hooks
+
+// Over-aligned new/delete keep the library defaults; they do not go
+// through these and are not counted
+void* operator new(size_t size) { return alloc_hooks::allocateOrThrow(size); }
+void* operator new[](size_t size) { return alloc_hooks::allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return alloc_hooks::allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return alloc_hooks::allocate(size); }
+void operator delete(void* p) noexcept { alloc_hooks::release(p); }
+void operator delete[](void* p) noexcept { alloc_hooks::release(p); }
+void operator delete(void* p, size_t) noexcept { alloc_hooks::release(p); }
+void operator delete[](void* p, size_t) noexcept { alloc_hooks::release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { alloc_hooks::release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { alloc_hooks::release(p); }
+
+#endif
@@ -0,0 +1,294 @@
+#ifndef ASYNC_REST_CLIENT_H
+#define ASYNC_REST_CLIENT_H
+
+#include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tsc_clock.h"
+#include "alloc_tracker.h"
+
+struct RestResponse {
+    bool ok = false;            // transfer completed (any HTTP status)
+    long httpStatus = 0;
+    std::string body;
+    std::string error;          // curl error text when !ok
+    long long latencyMicros = 0; // from hand-off to the IO thread until completion
+};
+
+using RestCallback = std::function<void(RestResponse&)>;
+
+// --------------------------------------------------------------------
+// AsyncRestClient: many concurrent HTTP POSTs on one curl multi handle
+//   - One IO thread drives curl_multi; callers on any thread submit
+//     requests and get a future (or a callback on the IO thread).
+//   - Easy handles are pooled and reused. Connections live in the multi
+//     handle's cache, so they stay alive across requests and are shared
+//     by all in-flight transfers.
+//   - In HTTP/2 mode concurrent requests are multiplexed as streams on a
+//     single connection instead of queueing behind each other (HTTP/1.1)
+//     or opening a connection each.
+// --------------------------------------------------------------------
+class AsyncRestClient {
+public:
+    enum class HttpVersion {
+        Http1_1,              // one request per connection at a time
+        Http2,                // h2 over TLS via ALPN, falls back to 1.1
+        Http2PriorKnowledge   // cleartext h2c without upgrade (local servers)
+    };
+
+    struct Options {
+        long maxHostConnections = 8;   // parallel connections per host
+        long timeoutMs = 5000;
+        long connectTimeoutMs = 2000;
+        HttpVersion httpVersion = HttpVersion::Http1_1;
+    };
+
+private:
+    struct Transfer {
+        std::string url;
+        std::string body;
+        std::vector<std::string> headerLines;
+        curl_slist* headers = nullptr;
+        CURL* easy = nullptr;
+        RestResponse response;
+        RestCallback callback;
+        uint64_t submittedAt = 0; // TscClock ticks
+    };
+
+    Options options;
+    CURLM* multi = nullptr;
+
+    std::mutex submitMutex;
+    std::vector<std::unique_ptr<Transfer>> submitted;
+
+    // IO thread only
+    std::vector<CURL*> idleHandles;
+    std::vector<std::unique_ptr<Transfer>> inFlight;
+
+    std::atomic<bool> running{true};
+    std::thread ioThread;
+
+    static size_t writeCallback(char* ptr, size_t size, size_t nmemb, std::string* data) {
+        data->append(ptr, size * nmemb);
+        return size * nmemb;
+    }
+
+    static void globalInit() {
+        static std::once_flag once;
+        std::call_once(once, []() { curl_global_init(CURL_GLOBAL_DEFAULT); });
+    }
+
+    CURL* acquireHandle() {
+        if (!idleHandles.empty()) {
+            CURL* easy = idleHandles.back();
+            idleHandles.pop_back();
+            return easy;
+        }
+        return curl_easy_init();
+    }
+
+    void releaseHandle(CURL* easy) {
+        curl_easy_reset(easy);
+        idleHandles.push_back(easy);
+    }
+
+    // Returns false (after completing 't' with an error) if it could not start
+    bool start(Transfer* t) {
+        t->easy = acquireHandle();
+        for (const auto& line : t->headerLines) {
+            t->headers = curl_slist_append(t->headers, line.c_str());
+        }
+
+        CURL* easy = t->easy;
+        curl_easy_setopt(easy, CURLOPT_URL, t->url.c_str());
+        curl_easy_setopt(easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, t->body.c_str());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(t->body.size()));
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, writeCallback);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, &t->response.body);
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, t->headers);
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, t);
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, options.timeoutMs);
+        curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, options.connectTimeoutMs);
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_TCP_NODELAY, 1L);
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPIDLE, 120L);
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPINTVL, 60L);
+        curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT, 60L);
+
+        if (options.httpVersion == HttpVersion::Http1_1) {
+            curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_1_1));
+        } else {
+            long version = options.httpVersion == HttpVersion::Http2
+                ? static_cast<long>(CURL_HTTP_VERSION_2TLS)
+                : static_cast<long>(CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+            curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, version);
+            // Wait for an existing connection to multiplex on rather than
+            // opening a new one while the first handshake is in progress
+            curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+        }
+
+        CURLMcode rc = curl_multi_add_handle(multi, easy);
+        if (rc != CURLM_OK) {
+            t->response.error = curl_multi_strerror(rc);
+            complete(t);
+            return false;
+        }
+        return true;
+    }
+
+    void complete(Transfer* t) {
+        t->response.latencyMicros = TscClock::microsBetween(t->submittedAt, TscClock::now());
+
+        if (t->callback) {
+            try {
+                t->callback(t->response);
+            } catch (const std::exception& e) {
+                std::cerr << "Error in REST completion callback: " << e.what() << std::endl;
+            }
+        }
+
+        curl_slist_free_all(t->headers);
+        t->headers = nullptr;
+        if (t->easy) {
+            releaseHandle(t->easy);
+            t->easy = nullptr;
+        }
+    }
+
+    void drainCompleted() {
+        int remaining = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &remaining)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CURL* easy = msg->easy_handle;
+            Transfer* t = nullptr;
+            curl_easy_getinfo(easy, CURLINFO_PRIVATE, reinterpret_cast<char**>(&t));
+            curl_multi_remove_handle(multi, easy);
+
+            if (msg->data.result == CURLE_OK) {
+                t->response.ok = true;
+                curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &t->response.httpStatus);
+            } else {
+                t->response.error = curl_easy_strerror(msg->data.result);
+            }
+            complete(t);
+
+            for (auto it = inFlight.begin(); it != inFlight.end(); ++it) {
+                if (it->get() == t) {
+                    *it = std::move(inFlight.back());
+                    inFlight.pop_back();
+                    break;
+                }
+            }
+        }
+    }
+
+    void run() {
+        AllocScope allocScope(AllocTag::Rest);
+        std::vector<std::unique_ptr<Transfer>> batch;
+        while (running) {
+            {
+                std::lock_guard<std::mutex> lock(submitMutex);
+                batch.swap(submitted);
+            }
+            for (auto& t : batch) {
+                if (start(t.get())) {
+                    inFlight.push_back(std::move(t));
+                }
+            }
+            batch.clear();
+
+            int active = 0;
+            curl_multi_perform(multi, &active);
+            drainCompleted();
+
+            // Sleeps until socket activity, a timeout, or curl_multi_wakeup()
+            curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+        }
+
+        // Fail whatever is left
+        for (auto& t : inFlight) {
+            if (t->easy) {
+                curl_multi_remove_handle(multi, t->easy);
+            }
+            t->response.error = "REST client shutting down";
+            complete(t.get());
+        }
+        inFlight.clear();
+        std::lock_guard<std::mutex> lock(submitMutex);
+        for (auto& t : submitted) {
+            t->response.error = "REST client shutting down";
+            complete(t.get());
+        }
+        submitted.clear();
+    }
+
+public:
+    AsyncRestClient() : AsyncRestClient(Options{}) {}
+
+    explicit AsyncRestClient(Options opts) : options(opts) {
+        globalInit();
+        multi = curl_multi_init();
+        curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, options.maxHostConnections);
+        if (options.httpVersion != HttpVersion::Http1_1) {
+            // All concurrent requests share one TLS session as h2 streams
+            curl_multi_setopt(multi, CURLMOPT_PIPELINING, static_cast<long>(CURLPIPE_MULTIPLEX));
+        }
+        ioThread = std::thread([this]() { run(); });
+    }
+
+    AsyncRestClient(const AsyncRestClient&) = delete;
+    AsyncRestClient& operator=(const AsyncRestClient&) = delete;
+
+    ~AsyncRestClient() {
+        running = false;
+        curl_multi_wakeup(multi);
+        if (ioThread.joinable()) {
+            ioThread.join();
+        }
+        for (CURL* easy : idleHandles) {
+            curl_easy_cleanup(easy);
+        }
+        curl_multi_cleanup(multi);
+    }
+
+    // Queue a POST; 'callback' runs on the IO thread when it completes
+    void post(const std::string& url, std::string body, std::vector<std::string> headerLines,
+              RestCallback callback) {
+        auto t = std::make_unique<Transfer>();
+        t->url = url;
+        t->body = std::move(body);
+        t->headerLines = std::move(headerLines);
+        t->callback = std::move(callback);
+        t->submittedAt = TscClock::now();
+        {
+            std::lock_guard<std::mutex> lock(submitMutex);
+            submitted.push_back(std::move(t));
+        }
+        curl_multi_wakeup(multi);
+    }
+
+    // Queue a POST and get the response through a future
+    std::future<RestResponse> post(const std::string& url, std::string body,
+                                   std::vector<std::string> headerLines) {
+        auto promise = std::make_shared<std::promise<RestResponse>>();
+        std::future<RestResponse> future = promise->get_future();
+        post(url, std::move(body), std::move(headerLines), [promise](RestResponse& response) {
+            promise->set_value(std::move(response));
+        });
+        return future;
+    }
+};
+
+#endif // ASYNC_REST_CLIENT_H
@@ -0,0 +1,301 @@
+#ifndef BOOK_FEED_H
+#define BOOK_FEED_H
+
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "order_book.h"
+
+using json = nlohmann::json;
+
+// Fetches a full REST snapshot; returns the public/get_order_book JSON-RPC response
+using BookSnapshotFetcher = std::function<json(const std::string& instrument)>;
+
+// --------------------------------------------------------------------
+// BookDelta: an owning copy of a book update
+//   Used for deltas buffered during a resync and for REST snapshots,
+//   which are converted here on the resync thread rather than on the
+//   IO thread.
+// --------------------------------------------------------------------
+struct BookDelta {
+    std::vector<LevelUpdate> bids;
+    std::vector<LevelUpdate> asks;
+    int64_t timestamp = 0;
+    int64_t changeId = 0;
+    int64_t prevChangeId = 0;
+    bool isSnapshot = false;
+    bool truncated = false;
+
+    static BookDelta copyOf(const BookUpdateView& update) {
+        BookDelta delta;
+        delta.bids.assign(update.bids, update.bids + update.bidCount);
+        delta.asks.assign(update.asks, update.asks + update.askCount);
+        delta.timestamp = update.timestamp;
+        delta.changeId = update.changeId;
+        delta.prevChangeId = update.prevChangeId;
+        delta.isSnapshot = update.isSnapshot;
+        delta.truncated = update.truncated;
+        return delta;
+    }
+
+    // From the "result" of public/get_order_book ([price, amount] levels)
+    static BookDelta fromSnapshotJson(const json& result) {
+        BookDelta delta;
+        delta.isSnapshot = true;
+        for (const auto& level : result.value("bids", json::array())) {
+            delta.bids.push_back({toFixedPrice(level[0].get<double>()), level[1].get<double>(), LevelAction::New});
+        }
+        for (const auto& level : result.value("asks", json::array())) {
+            delta.asks.push_back({toFixedPrice(level[0].get<double>()), level[1].get<double>(), LevelAction::New});
+        }
+        delta.timestamp = result.value("timestamp", int64_t(0));
+        delta.changeId = result.value("change_id", int64_t(0));
+        return delta;
+    }
+
+    BookUpdateView view() const {
+        BookUpdateView v;
+        v.bids = bids.data();
+        v.bidCount = bids.size();
+        v.asks = asks.data();
+        v.askCount = asks.size();
+        v.timestamp = timestamp;
+        v.changeId = changeId;
+        v.prevChangeId = prevChangeId;
+        v.isSnapshot = isSnapshot;
+        v.truncated = truncated;
+        return v;
+    }
+};
+
+class IncrementalBookFeed;
+
+// What IncrementalBookFeed::onUpdate did with an update
+enum class BookFeedResult {
+    Applied,   // applied to the book as given
+    Buffered,  // held back while resyncing; the book did not change
+    Resynced   // a snapshot plus buffered deltas replaced the book
+};
+
+// --------------------------------------------------------------------
+// BookResyncWorker: runs snapshot fetches off the WebSocket IO thread
+//   A gap on any feed enqueues a job here; the REST round trip happens
+//   on this thread and the result is handed back to the feed, which
+//   applies it the next time the IO thread delivers a delta.
+// --------------------------------------------------------------------
+class BookResyncWorker {
+private:
+    BookSnapshotFetcher fetcher;
+    std::deque<IncrementalBookFeed*> jobs;
+    std::mutex jobMutex;
+    std::condition_variable jobCv;
+    std::atomic<bool> running{true};
+    std::thread worker;
+
+    void run();
+
+public:
+    explicit BookResyncWorker(BookSnapshotFetcher snapshotFetcher)
+        : fetcher(std::move(snapshotFetcher)), worker([this]() { run(); }) {}
+
+    ~BookResyncWorker() {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            running = false;
+        }
+        jobCv.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    void requestSnapshot(IncrementalBookFeed* feed) {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            jobs.push_back(feed);
+        }
+        jobCv.notify_one();
+    }
+};
+
+// --------------------------------------------------------------------
+// IncrementalBookFeed: applies book.<instrument>.raw deltas to an OrderBook
+//   - Every change message must have prev_change_id equal to the last
+//     change_id we applied; otherwise we lost a message.
+//   - On a gap, deltas are buffered (IO thread only, no locking) and a
+//     snapshot is requested from the resync worker.
+//   - Once the snapshot arrives, deltas newer than its change_id are
+//     replayed on top of it and the feed goes live again.
+// --------------------------------------------------------------------
+class IncrementalBookFeed {
+private:
+    // Deltas buffered while waiting for a snapshot; beyond this we drop
+    // the buffer and ask for a fresh snapshot once the current one lands.
+    static constexpr size_t kMaxPendingDeltas = 10000;
+
+    OrderBook& book;
+    BookResyncWorker& resyncWorker;
+
+    // IO thread state
+    int64_t lastChangeId = 0;
+    bool synced = false;
+    bool resyncing = false;
+    bool pendingOverflowed = false;
+    std::deque<BookDelta> pendingDeltas;
+
+    // Handed over from the resync worker
+    std::atomic<BookDelta*> readySnapshot{nullptr};
+
+    // Statistics (readable from any thread)
+    std::atomic<uint64_t> gapCount{0};
+    std::atomic<uint64_t> resyncCount{0};
+
+    void startResync() {
+        resyncing = true;
+        synced = false;
+        resyncCount.fetch_add(1, std::memory_order_relaxed);
+        resyncWorker.requestSnapshot(this);
+    }
+
+    void buffer(const BookUpdateView& update) {
+        if (pendingDeltas.size() >= kMaxPendingDeltas) {
+            pendingDeltas.clear();
+            pendingOverflowed = true;
+        }
+        pendingDeltas.push_back(BookDelta::copyOf(update));
+    }
+
+    // Apply a snapshot plus whatever buffered deltas chain onto it
+    void applySnapshot(const BookDelta& snapshot) {
+        book.applyUpdate(snapshot.view());
+        lastChangeId = snapshot.changeId;
+        resyncing = false;
+
+        if (pendingOverflowed) {
+            // Deltas between the snapshot and the buffer were discarded
+            pendingOverflowed = false;
+            pendingDeltas.clear();
+            startResync();
+            return;
+        }
+
+        while (!pendingDeltas.empty()) {
+            const BookDelta& delta = pendingDeltas.front();
+            if (delta.changeId <= lastChangeId) {
+                pendingDeltas.pop_front(); // already contained in the snapshot
+                continue;
+            }
+            if (delta.isSnapshot) {
+                // A newer exchange snapshot replaces the book, as in onUpdate()
+                book.applyUpdate(delta.view());
+                lastChangeId = delta.changeId;
+                pendingDeltas.pop_front();
+                continue;
+            }
+            if (delta.prevChangeId != lastChangeId || delta.truncated) {
+                // Snapshot is older than the buffered deltas; try again
+                startResync();
+                return;
+            }
+            book.applyUpdate(delta.view());
+            lastChangeId = delta.changeId;
+            pendingDeltas.pop_front();
+        }
+
+        synced = true;
+    }
+
+public:
+    IncrementalBookFeed(OrderBook& orderBook, BookResyncWorker& worker)
+        : book(orderBook), resyncWorker(worker) {}
+
+    ~IncrementalBookFeed() {
+        delete readySnapshot.exchange(nullptr);
+    }
+
+    // Called by the resync worker with a REST snapshot
+    void deliverSnapshot(BookDelta snapshot) {
+        delete readySnapshot.exchange(new BookDelta(std::move(snapshot)), std::memory_order_acq_rel);
+    }
+
+    // Called on the WebSocket IO thread with each decoded book notification
+    BookFeedResult onUpdate(const BookUpdateView& update) {
+        if (resyncing) {
+            buffer(update);
+            if (readySnapshot.load(std::memory_order_relaxed) != nullptr) {
+                std::unique_ptr<BookDelta> snapshot(readySnapshot.exchange(nullptr, std::memory_order_acq_rel));
+                if (snapshot) {
+                    applySnapshot(*snapshot);
+                    return BookFeedResult::Resynced;
+                }
+            }
+            return BookFeedResult::Buffered;
+        }
+
+        // A snapshot message from the exchange always (re)starts the chain
+        if (update.isSnapshot) {
+            book.applyUpdate(update);
+            lastChangeId = update.changeId;
+            synced = true;
+            return BookFeedResult::Applied;
+        }
+
+        // A delta the parser could not hold completely is as bad as a gap
+        if (!synced || update.prevChangeId != lastChangeId || update.truncated) {
+            gapCount.fetch_add(1, std::memory_order_relaxed);
+            buffer(update);
+            startResync();
+            return BookFeedResult::Buffered;
+        }
+
+        book.applyUpdate(update);
+        lastChangeId = update.changeId;
+        return BookFeedResult::Applied;
+    }
+
+    const std::string& getInstrument() const { return book.getInstrument(); }
+    uint64_t getGapCount() const { return gapCount.load(std::memory_order_relaxed); }
+    uint64_t getResyncCount() const { return resyncCount.load(std::memory_order_relaxed); }
+};
+
+inline void BookResyncWorker::run() {
+    while (true) {
+        IncrementalBookFeed* feed = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobCv.wait(lock, [this]() { return !running || !jobs.empty(); });
+            if (!running) {
+                return;
+            }
+            feed = jobs.front();
+            jobs.pop_front();
+        }
+
+        try {
+            json response = fetcher(feed->getInstrument());
+            if (response.contains("result")) {
+                feed->deliverSnapshot(BookDelta::fromSnapshotJson(response["result"]));
+            } else {
+                std::cerr << "Order book resync failed for " << feed->getInstrument()
+                          << ". Response: " << response.dump() << std::endl;
+                requestSnapshot(feed); // keep trying; deltas are still being buffered
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error fetching order book snapshot: " << e.what() << std::endl;
+            requestSnapshot(feed);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+    }
+}
+
+#endif // BOOK_FEED_H
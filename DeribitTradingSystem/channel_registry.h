@@ -0,0 +1,121 @@
+#ifndef CHANNEL_REGISTRY_H
+#define CHANNEL_REGISTRY_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using ChannelId = uint32_t;
+constexpr ChannelId kInvalidChannel = 0xFFFFFFFFu;
+
+// Hash over the raw bytes, 8 at a time (channel names are 20-40 bytes)
+inline uint64_t hashChannelName(std::string_view name) {
+    constexpr uint64_t kMul = 0x9E3779B97F4A7C15ull;
+    uint64_t h = name.size() * kMul;
+    const char* p = name.data();
+    size_t remaining = name.size();
+    while (remaining >= 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, p, 8);
+        h = (h ^ chunk) * kMul;
+        h ^= h >> 29;
+        p += 8;
+        remaining -= 8;
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, p, remaining);
+    h = (h ^ tail) * kMul;
+    h ^= h >> 32;
+    return h;
+}
+
+// Instrument part of a subscription channel name: "book.BTC-PERPETUAL.100ms"
+// and "user.orders.BTC-PERPETUAL.raw" both give "BTC-PERPETUAL". Empty
+// if the channel has no instrument field.
+inline std::string_view channelInstrument(std::string_view channel) {
+    size_t field = channel.compare(0, 5, "user.") == 0 ? 2 : 1;
+    size_t start = 0;
+    for (size_t i = 0; i < field; ++i) {
+        start = channel.find('.', start);
+        if (start == std::string_view::npos) {
+            return {};
+        }
+        ++start;
+    }
+    size_t end = channel.find('.', start);
+    return channel.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+}
+
+// --------------------------------------------------------------------
+// ChannelRegistry: interns channel names to small dense integer IDs
+//   - intern() runs at registration time and may allocate.
+//   - find() runs per message: one hash over the raw bytes, then linear
+//     probing in a flat table kept at most half full. No allocation,
+//     no std::string construction.
+//   IDs are never reused, so they can index flat per-channel arrays.
+// --------------------------------------------------------------------
+class ChannelRegistry {
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        ChannelId id = kInvalidChannel;
+    };
+
+    std::vector<Slot> slots = std::vector<Slot>(64);
+    std::vector<std::string> names;
+
+    size_t mask() const { return slots.size() - 1; }
+
+    void insertSlot(uint64_t hash, ChannelId id) {
+        size_t i = hash & mask();
+        while (slots[i].id != kInvalidChannel) {
+            i = (i + 1) & mask();
+        }
+        slots[i] = Slot{hash, id};
+    }
+
+    void grow() {
+        std::vector<Slot> old = std::move(slots);
+        slots.assign(old.size() * 2, Slot{});
+        for (const Slot& slot : old) {
+            if (slot.id != kInvalidChannel) {
+                insertSlot(slot.hash, slot.id);
+            }
+        }
+    }
+
+public:
+    ChannelId find(std::string_view name) const {
+        uint64_t hash = hashChannelName(name);
+        size_t i = hash & mask();
+        while (slots[i].id != kInvalidChannel) {
+            if (slots[i].hash == hash && names[slots[i].id] == name) {
+                return slots[i].id;
+            }
+            i = (i + 1) & mask();
+        }
+        return kInvalidChannel;
+    }
+
+    // Returns the existing ID for 'name', or assigns the next one
+    ChannelId intern(std::string_view name) {
+        ChannelId existing = find(name);
+        if (existing != kInvalidChannel) {
+            return existing;
+        }
+        if ((names.size() + 1) * 2 > slots.size()) {
+            grow();
+        }
+        ChannelId id = static_cast<ChannelId>(names.size());
+        names.emplace_back(name);
+        insertSlot(hashChannelName(name), id);
+        return id;
+    }
+
+    const std::string& name(ChannelId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+};
+
+#endif // CHANNEL_REGISTRY_H
@@ -0,0 +1,35 @@
+#ifndef ENDPOINTS_H
+#define ENDPOINTS_H
+
+#include <cstdlib>
+#include <string>
+
+// --------------------------------------------------------------------
+// DeribitEndpoints: where the REST and WebSocket APIs are served
+//   Defaults to the Deribit testnet. DERIBIT_REST_URL and DERIBIT_WS_URL
+//   override them, e.g. to run against mock_exchange:
+//     DERIBIT_REST_URL=http://127.0.0.1:8080/api/v2
+//     DERIBIT_WS_URL=ws://127.0.0.1:8081/ws/api/v2
+//   ws:// URLs use a plain TCP connection, wss:// URLs TLS.
+// --------------------------------------------------------------------
+struct DeribitEndpoints {
+    std::string restUrl = "https://test.deribit.com/api/v2";
+    std::string wsUrl = "wss://test.deribit.com/ws/api/v2";
+
+    static DeribitEndpoints fromEnvironment() {
+        DeribitEndpoints endpoints;
+        if (const char* rest = std::getenv("DERIBIT_REST_URL")) {
+            if (*rest) {
+                endpoints.restUrl = rest;
+            }
+        }
+        if (const char* ws = std::getenv("DERIBIT_WS_URL")) {
+            if (*ws) {
+                endpoints.wsUrl = ws;
+            }
+        }
+        return endpoints;
+    }
+};
+
+#endif // ENDPOINTS_H
@@ -0,0 +1,240 @@
+#ifndef HW_COUNTERS_H
+#define HW_COUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Operations sampled with hardware counters
+enum class HwOp : size_t {
+    FeedMessage,    // one incoming WebSocket message: parse and dispatch
+    OrderRequest    // one order request: encode, send, handle the reply
+};
+constexpr size_t kHwOpCount = 2;
+
+inline const char* hwOpName(HwOp op) {
+    switch (op) {
+        case HwOp::FeedMessage: return "feed_message";
+        case HwOp::OrderRequest: return "order_request";
+    }
+    return "unknown";
+}
+
+// Totals for one operation (counts are user space only)
+struct HwOpStats {
+    uint64_t samples = 0;
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cacheMisses = 0;
+    uint64_t branchMisses = 0;
+
+    double ipc() const {
+        return cycles ? static_cast<double>(instructions) / cycles : 0.0;
+    }
+    double perSample(uint64_t total) const {
+        return samples ? static_cast<double>(total) / samples : 0.0;
+    }
+};
+
+// --------------------------------------------------------------------
+// HardwareCounters: perf_event_open counters around hot operations
+//   - Off until enable() succeeds. Each sampling thread then opens its
+//     own group (cycles, instructions, cache misses, branch misses) on
+//     first use; the group is read once before and once after the
+//     operation, so the four values always cover the same interval.
+//   - Only the calling thread's user-space work is counted: time spent
+//     blocked (e.g. waiting for an order ack) costs nothing.
+//   - Each read is a syscall (~1 us), so leave this off when measuring
+//     wall-clock latency.
+//   Linux only. Needs a PMU (often missing in VMs) and
+//   kernel.perf_event_paranoid <= 2.
+// --------------------------------------------------------------------
+class HardwareCounters {
+public:
+    static constexpr size_t kEventCount = 4;
+
+private:
+    struct alignas(64) OpTotals {
+        std::atomic<uint64_t> samples{0};
+        std::array<std::atomic<uint64_t>, kEventCount> values{};
+    };
+
+    std::atomic<bool> countersEnabled{false};
+    std::array<OpTotals, kHwOpCount> totals;
+
+#ifdef __linux__
+    struct EventSpec {
+        uint32_t type;
+        uint64_t config;
+    };
+    static constexpr EventSpec kEvents[kEventCount] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+    };
+
+    // PERF_FORMAT_GROUP | TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING layout
+    struct GroupRead {
+        uint64_t count;
+        uint64_t timeEnabled;
+        uint64_t timeRunning;
+        uint64_t values[kEventCount];
+    };
+
+    // One counter group per thread; fd[0] is the group leader
+    class ThreadGroup {
+    private:
+        int fds[kEventCount] = {-1, -1, -1, -1};
+        bool attempted = false;
+
+    public:
+        ~ThreadGroup() {
+            for (int fd : fds) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+        }
+
+        // Opens the group on first call; false if this thread cannot count
+        bool open(std::string* error = nullptr) {
+            if (attempted) {
+                return fds[0] >= 0;
+            }
+            attempted = true;
+            for (size_t i = 0; i < kEventCount; ++i) {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = kEvents[i].type;
+                attr.config = kEvents[i].config;
+                attr.disabled = i == 0 ? 1 : 0;  // the leader starts the group
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                                   PERF_FORMAT_TOTAL_TIME_RUNNING;
+                fds[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : fds[0], 0));
+                if (fds[i] < 0) {
+                    if (error) {
+                        *error = std::strerror(errno);
+                    }
+                    for (int& fd : fds) {
+                        if (fd >= 0) {
+                            ::close(fd);
+                        }
+                        fd = -1;
+                    }
+                    return false;
+                }
+            }
+            ::ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ::ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            return true;
+        }
+
+        bool read(GroupRead& out) const {
+            return fds[0] >= 0 && ::read(fds[0], &out, sizeof(out)) == static_cast<ssize_t>(sizeof(out)) &&
+                   out.count == kEventCount;
+        }
+    };
+
+    static ThreadGroup& threadGroup() {
+        static thread_local ThreadGroup group;
+        return group;
+    }
+#endif
+
+public:
+    // Open counters on the calling thread to check they work, then start
+    // sampling. Returns false (and stays off) if they are unavailable.
+    bool enable() {
+#ifdef __linux__
+        std::string error;
+        if (!threadGroup().open(&error)) {
+            std::cerr << "Hardware counters unavailable"
+                      << (error.empty() ? "" : ": " + error) << std::endl;
+            return false;
+        }
+        countersEnabled.store(true, std::memory_order_relaxed);
+        return true;
+#else
+        std::cerr << "Hardware counters are only supported on Linux" << std::endl;
+        return false;
+#endif
+    }
+
+    bool enabled() const {
+        return countersEnabled.load(std::memory_order_relaxed);
+    }
+
+    HwOpStats stats(HwOp op) const {
+        const OpTotals& t = totals[static_cast<size_t>(op)];
+        HwOpStats s;
+        s.samples = t.samples.load(std::memory_order_relaxed);
+        s.cycles = t.values[0].load(std::memory_order_relaxed);
+        s.instructions = t.values[1].load(std::memory_order_relaxed);
+        s.cacheMisses = t.values[2].load(std::memory_order_relaxed);
+        s.branchMisses = t.values[3].load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // Measures the enclosing scope as one sample of 'op'
+    class Scope {
+    private:
+        HardwareCounters& owner;
+        HwOp op;
+        bool active = false;
+#ifdef __linux__
+        GroupRead before{};
+#endif
+
+    public:
+        Scope(HardwareCounters& counters, HwOp operation) : owner(counters), op(operation) {
+#ifdef __linux__
+            if (owner.enabled()) {
+                ThreadGroup& group = threadGroup();
+                active = group.open() && group.read(before);
+            }
+#endif
+        }
+
+        ~Scope() {
+#ifdef __linux__
+            GroupRead after{};
+            if (!active || !threadGroup().read(after)) {
+                return;
+            }
+            // If the kernel multiplexed the group off the PMU for part of
+            // the interval, scale up to the full interval
+            uint64_t enabledDelta = after.timeEnabled - before.timeEnabled;
+            uint64_t runningDelta = after.timeRunning - before.timeRunning;
+            if (runningDelta == 0) {
+                return;
+            }
+            double scale = static_cast<double>(enabledDelta) / runningDelta;
+            OpTotals& t = owner.totals[static_cast<size_t>(op)];
+            t.samples.fetch_add(1, std::memory_order_relaxed);
+            for (size_t i = 0; i < kEventCount; ++i) {
+                uint64_t delta = after.values[i] - before.values[i];
+                t.values[i].fetch_add(static_cast<uint64_t>(delta * scale), std::memory_order_relaxed);
+            }
+#endif
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+#endif // HW_COUNTERS_H
@@ -0,0 +1,189 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+// --------------------------------------------------------------------
+// LatencyHistogram: fixed-memory log-linear histogram (HDR style)
+//   - Values below 128 get their own bucket. Above that, each power of
+//     two is split into 64 linear sub-buckets, so any recorded value is
+//     reported within 1/64 (~1.6%) of its true value.
+//   - record() is a shift, a count-leading-zeros and an increment: O(1),
+//     no allocation, and memory does not grow with the sample count.
+//   - Histograms with the same layout merge by adding counts, so
+//     per-thread or per-interval histograms can be combined later.
+//   Not thread-safe; callers synchronize or keep one per thread.
+// --------------------------------------------------------------------
+class LatencyHistogram {
+    friend class HistogramRecorder;
+
+public:
+    static constexpr int kSubBucketBits = 7;
+    static constexpr uint64_t kSubBucketCount = 1ull << kSubBucketBits;   // 128
+    static constexpr uint64_t kSubBucketHalf = kSubBucketCount / 2;       // 64
+    static constexpr int kMaxValueBits = 40;
+    static constexpr uint64_t kMaxValue = (1ull << kMaxValueBits) - 1;  // larger values are clamped
+    static constexpr size_t kBucketCount =
+        (kMaxValueBits - kSubBucketBits + 2) * kSubBucketHalf;
+
+private:
+    std::array<uint64_t, kBucketCount> counts{};
+    uint64_t totalCount = 0;
+    uint64_t sum = 0;
+    uint64_t minValue = std::numeric_limits<uint64_t>::max();
+    uint64_t maxValue = 0;
+
+    static int highestBit(uint64_t value) {
+        return 63 - __builtin_clzll(value);
+    }
+
+public:
+    static size_t bucketIndex(uint64_t value) {
+        if (value < kSubBucketCount) {
+            return static_cast<size_t>(value);
+        }
+        // Keep the top kSubBucketBits bits: (value >> shift) is in [64, 128)
+        int shift = highestBit(value) - (kSubBucketBits - 1);
+        return static_cast<size_t>((shift + 1) * kSubBucketHalf + ((value >> shift) - kSubBucketHalf));
+    }
+
+    // Smallest and largest values that land in bucket 'index'
+    static uint64_t bucketLowest(size_t index) {
+        if (index < kSubBucketCount) {
+            return index;
+        }
+        int shift = static_cast<int>(index / kSubBucketHalf) - 1;
+        uint64_t sub = index % kSubBucketHalf + kSubBucketHalf;
+        return sub << shift;
+    }
+
+    static uint64_t bucketHighest(size_t index) {
+        if (index < kSubBucketCount) {
+            return index;
+        }
+        int shift = static_cast<int>(index / kSubBucketHalf) - 1;
+        uint64_t sub = index % kSubBucketHalf + kSubBucketHalf;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void record(uint64_t value) {
+        value = std::min(value, kMaxValue);
+        ++counts[bucketIndex(value)];
+        ++totalCount;
+        sum += value;
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        if (other.totalCount == 0) {
+            return;
+        }
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            counts[i] += other.counts[i];
+        }
+        totalCount += other.totalCount;
+        sum += other.sum;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    void reset() {
+        *this = LatencyHistogram();
+    }
+
+    uint64_t count() const { return totalCount; }
+    uint64_t min() const { return totalCount ? minValue : 0; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return totalCount ? sum / static_cast<double>(totalCount) : 0.0; }
+
+    // Value at or below which 'percentile' percent of samples fall
+    // (reported as the top of its bucket, capped at the observed max)
+    uint64_t percentile(double percentile) const {
+        if (totalCount == 0) {
+            return 0;
+        }
+        double clamped = std::min(std::max(percentile, 0.0), 100.0);
+        uint64_t rank = static_cast<uint64_t>(clamped / 100.0 * totalCount + 0.5);
+        rank = std::max<uint64_t>(rank, 1);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return std::min(std::max(bucketHighest(i), minValue), maxValue);
+            }
+        }
+        return maxValue;
+    }
+};
+
+// --------------------------------------------------------------------
+// HistogramRecorder: single-writer histogram that another thread can read
+//   The owning thread updates each field with a relaxed load and store
+//   (plain moves on x86, no lock prefix, no fences). Any thread may call
+//   copyTo() at any time and gets a view that is at most a few samples
+//   stale; counts never go backwards.
+// --------------------------------------------------------------------
+class HistogramRecorder {
+private:
+    std::array<std::atomic<uint64_t>, LatencyHistogram::kBucketCount> counts{};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> minValue{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> maxValue{0};
+
+    static void bump(std::atomic<uint64_t>& field, uint64_t by) {
+        field.store(field.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+public:
+    // Owning thread only
+    void record(uint64_t value) {
+        value = std::min(value, LatencyHistogram::kMaxValue);
+        bump(counts[LatencyHistogram::bucketIndex(value)], 1);
+        bump(sum, value);
+        if (value < minValue.load(std::memory_order_relaxed)) {
+            minValue.store(value, std::memory_order_relaxed);
+        }
+        if (value > maxValue.load(std::memory_order_relaxed)) {
+            maxValue.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread: adds this recorder's counts into 'target'
+    void copyTo(LatencyHistogram& target) const {
+        uint64_t total = 0;
+        size_t first = 0;
+        size_t last = 0;
+        for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+            uint64_t n = counts[i].load(std::memory_order_relaxed);
+            if (n == 0) {
+                continue;
+            }
+            if (total == 0) {
+                first = i;
+            }
+            last = i;
+            target.counts[i] += n;
+            total += n;
+        }
+        if (total == 0) {
+            return;
+        }
+        // The count is derived from the buckets read above so percentiles
+        // stay consistent; min/max may lag a sample, so bound them by the
+        // occupied buckets
+        target.totalCount += total;
+        target.sum += sum.load(std::memory_order_relaxed);
+        uint64_t lowest = std::min(minValue.load(std::memory_order_relaxed), LatencyHistogram::bucketHighest(first));
+        uint64_t highest = std::max(maxValue.load(std::memory_order_relaxed), LatencyHistogram::bucketLowest(last));
+        target.minValue = std::min(target.minValue, lowest);
+        target.maxValue = std::max(target.maxValue, highest);
+    }
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -8,12 +8,32 @@
 #include <vector>
 #include <functional>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <mutex>
+#include <memory>
+#include <future>
 #include "websocket_client.h"
 #include <numeric>
 #include <algorithm>
 #include <iomanip>
+#include <fstream>
+#include <cstdlib>
 #include "performance_monitor.h"
+#include "order_book.h"
+#include "book_feed.h"
+#include "async_rest_client.h"
+#include "order_templates.h"
+#include "tsc_clock.h"
+#include "metrics_server.h"
+#include "span_tracer.h"
+#include "endpoints.h"
+#include "market_data_server.h"
+#include "shm_bus.h"
+// Build with -DDERIBIT_TRACK_ALLOCATIONS to count heap use per subsystem;
+// this file then provides the global operator new/delete hooks
+#define DERIBIT_ALLOCATION_HOOKS_IMPLEMENTATION
+#include "alloc_tracker.h"
 
 using json = nlohmann::json;
 using namespace std::chrono;
@@ -44,8 +64,15 @@ PerformanceMonitor performanceMonitor;
 
 class DeribitAPIClient {
 private:
-    static inline CURL* curlHandle = nullptr;
-    static inline std::atomic<bool> initialized{false};
+    // Concurrent, keep-alive REST transport (safe to call from any thread)
+    AsyncRestClient restClient;
+
+    static AsyncRestClient::Options transportOptions(bool useHttp2) {
+        AsyncRestClient::Options options;
+        options.httpVersion = useHttp2 ? AsyncRestClient::HttpVersion::Http2
+                                       : AsyncRestClient::HttpVersion::Http1_1;
+        return options;
+    }
 
     // --------------------------------------------------------------------
     // 1. Configure your Deribit Test API credentials here
@@ -55,14 +82,8 @@ private:
     std::string clientSecret = "GJbkkwiwElUtOPZKolJ5SXjQHgh4vuVxMOmrqC534Yw";
     std::string accessToken;  // Retrieved via 'public/auth'
 
-    // Deribit Test endpoint
-    std::string apiUrl = "https://test.deribit.com/api/v2";
-
-    // Helper function to accumulate libcurl response
-    static size_t writeCallback(char* ptr, size_t size, size_t nmemb, std::string* data) {
-        data->append(ptr, size * nmemb);
-        return size * nmemb;
-    }
+    // Deribit Test endpoint unless DERIBIT_REST_URL says otherwise
+    std::string apiUrl = DeribitEndpoints::fromEnvironment().restUrl;
 
     // --------------------------------------------------------------------
     // 2. Deribit Authentication
@@ -93,91 +114,68 @@ private:
     }
 
 public:
-    DeribitAPIClient() {
-        // Initialize curl only once, in a thread-safe manner
-        if (!initialized.exchange(true)) {
-            curl_global_init(CURL_GLOBAL_DEFAULT);
-            curlHandle = curl_easy_init();
-            
-            // Set some connection optimization options
-            curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPALIVE, 1L);
-            curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPIDLE, 120L);
-            curl_easy_setopt(curlHandle, CURLOPT_TCP_KEEPINTVL, 60L);
-
-            // Allow persistent connections
-            curl_easy_setopt(curlHandle, CURLOPT_FORBID_REUSE, 0L);
-            curl_easy_setopt(curlHandle, CURLOPT_DNS_CACHE_TIMEOUT, 60L);
-        }
-        
+    // HTTP/2 multiplexes concurrent calls over one TLS session; the
+    // server falls back to HTTP/1.1 via ALPN if it does not support it
+    explicit DeribitAPIClient(bool useHttp2 = true) : restClient(transportOptions(useHttp2)) {
         // Perform initial authentication to retrieve the access token
         authenticate();
     }
 
     // --------------------------------------------------------------------
-    // 3. Core JSON-RPC request function
+    // 3. Core JSON-RPC request functions
     //    - Adds Authorization header if the method is private.
     //    - Measures round-trip latency in microseconds.
+    //    - sendRequestAsync returns immediately; any number of requests
+    //      can be in flight at once, from any thread.
     // --------------------------------------------------------------------
-    json sendRequest(const json& request, bool isPrivate = false) {
-        std::string readBuffer;
-        std::string requestStr = request.dump();
+    std::future<json> sendRequestAsync(const json& request, bool isPrivate = false) {
+        return sendRawRequestAsync(request.dump(), isPrivate);
+    }
 
+    // Same, for a request body that is already serialized
+    std::future<json> sendRawRequestAsync(std::string body, bool isPrivate = false) {
         // Build headers
-        struct curl_slist* headers = nullptr;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        headers = curl_slist_append(headers, "Accept: application/json");
+        std::vector<std::string> headers = {
+            "Content-Type: application/json",
+            "Accept: application/json"
+        };
 
         // If it's a private method, include the bearer token
         if (isPrivate && !accessToken.empty()) {
-            std::string authHeader = "Authorization: Bearer " + accessToken;
-            headers = curl_slist_append(headers, authHeader.c_str());
+            headers.push_back("Authorization: Bearer " + accessToken);
         }
 
-        // Reset and set options
-        curl_easy_reset(curlHandle);
-        curl_easy_setopt(curlHandle, CURLOPT_URL, apiUrl.c_str());
-        curl_easy_setopt(curlHandle, CURLOPT_POST, 1L);
-        curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDS, requestStr.c_str());
-        curl_easy_setopt(curlHandle, CURLOPT_POSTFIELDSIZE, requestStr.length());
-        curl_easy_setopt(curlHandle, CURLOPT_WRITEFUNCTION, writeCallback);
-        curl_easy_setopt(curlHandle, CURLOPT_WRITEDATA, &readBuffer);
-        curl_easy_setopt(curlHandle, CURLOPT_HTTPHEADER, headers);
+        auto promise = std::make_shared<std::promise<json>>();
+        std::future<json> future = promise->get_future();
 
-        // Set timeouts (tweak as needed)
-        curl_easy_setopt(curlHandle, CURLOPT_TIMEOUT_MS, 5000L);
-        curl_easy_setopt(curlHandle, CURLOPT_CONNECTTIMEOUT_MS, 2000L);
+        restClient.post(apiUrl, std::move(body), std::move(headers), [promise](RestResponse& response) {
+            if (!response.ok) {
+                std::cerr << "CURL Error: " << response.error << std::endl;
+                promise->set_value(json());
+                return;
+            }
 
-        // Measure latency
-        auto start = high_resolution_clock::now();
-        CURLcode res = curl_easy_perform(curlHandle);
-        auto end = high_resolution_clock::now();
-        
-        curl_slist_free_all(headers);
+            std::cout << "API Call Latency: " << response.latencyMicros << " microseconds" << std::endl;
 
-        if (res != CURLE_OK) {
-            std::cerr << "CURL Error: " << curl_easy_strerror(res) << std::endl;
-            return {};
-        }
+            // Record latency for performance monitoring
+            performanceMonitor.recordRestApiLatency(response.latencyMicros);
 
-        auto latency = duration_cast<microseconds>(end - start).count();
-        std::cout << "API Call Latency: " << latency << " microseconds" << std::endl;
-        
-        // Record latency for performance monitoring
-        performanceMonitor.recordRestApiLatency(latency);
+            try {
+                promise->set_value(json::parse(response.body));
+            } catch (const std::exception& e) {
+                std::cerr << "JSON Parse Error: " << e.what() << std::endl;
+                promise->set_value(json());
+            }
+        });
+        return future;
+    }
 
-        try {
-            return json::parse(readBuffer);
-        } catch (const std::exception& e) {
-            std::cerr << "JSON Parse Error: " << e.what() << std::endl;
-            return {};
-        }
+    json sendRequest(const json& request, bool isPrivate = false) {
+        return sendRequestAsync(request, isPrivate).get();
     }
 
-    ~DeribitAPIClient() {
-        if (curlHandle) {
-            curl_easy_cleanup(curlHandle);
-            curl_global_cleanup();
-        }
+    json sendRawRequest(std::string body, bool isPrivate = false) {
+        return sendRawRequestAsync(std::move(body), isPrivate).get();
     }
 };
 
@@ -188,23 +186,163 @@ class OrderManager {
 private:
     DeribitAPIClient apiClient;
 
-public:
-    // Place a limit buy order
-    bool placeOrder(const std::string& instrument, double price, double amount) {
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", 101},
-            {"method", "private/buy"},
-            {"params", {
-                {"instrument_name", instrument},
-                {"amount", amount},
-                {"price", price},
-                {"type", "limit"}
-            }}
+    // When set and authenticated, order entry goes over this socket
+    // instead of a REST round trip
+    DeribitWebSocketClient* wsClient = nullptr;
+    static constexpr std::chrono::milliseconds kWebSocketOrderTimeout{5000};
+
+    // Order requests are rendered from byte templates rather than built
+    // as json trees (order entry runs on one thread, the CLI's)
+    OrderRequestEncoder orderEncoder;
+
+    // Lifecycle tracing: each request gets a trace id; acknowledged orders
+    // stay in 'workingOrders' until user.orders reports them closed
+    std::atomic<uint64_t> nextTraceId{1};
+    std::mutex workingOrdersMutex;
+    std::unordered_map<std::string, uint64_t> workingOrders; // order_id -> trace id
+
+    // Remember an acknowledged order so later fills can be tied to it
+    void trackOrderAck(const json& response, uint64_t traceId) {
+        if (!response.contains("result") || !response["result"].contains("order")) {
+            return;
+        }
+        const json& order = response["result"]["order"];
+        if (!order.contains("order_id") || !order["order_id"].is_string()) {
+            return;
+        }
+        std::string state = order.value("order_state", "");
+        if (state == "open" || state == "untriggered") {
+            std::lock_guard<std::mutex> lock(workingOrdersMutex);
+            workingOrders.emplace(order["order_id"].get<std::string>(), traceId);
+            SpanTracer::instance().asyncBegin("order.working", traceId);
+        } else if (state == "filled") {
+            SpanTracer::instance().instant("order.filled", traceId);
+        }
+    }
+
+    // True for the response sendOrderRequest() returns when no WebSocket
+    // reply came in time: the request may still have reached the exchange
+    static bool outcomeUnknown(const json& response) {
+        return response.value("timed_out", false);
+    }
+
+    static void reportUnknownOutcome(const std::string& action) {
+        std::cerr << "Order " << action << " outcome unknown: no reply within "
+                  << kWebSocketOrderTimeout.count() << " ms; check private/get_open_orders_by_instrument"
+                  << " before retrying (a late acknowledgement is still tracked)" << std::endl;
+    }
+
+    // Send a private order method over the WebSocket if available, else
+    // REST. 'encode(id)' renders the request for the given id; the trace
+    // id the request is recorded under goes to 'traceIdOut' if given.
+    template <typename Encode>
+    json sendOrderRequest(const std::string& method, int restId, Encode&& encode, uint64_t* traceIdOut = nullptr) {
+        performanceMonitor.recordOrder();
+        HardwareCounters::Scope hwScope(performanceMonitor.hardware(), HwOp::OrderRequest);
+        if (wsClient && wsClient->lastMessageTicks() != 0) {
+            performanceMonitor.recordLatency(LatencyMetric::TickToTrade,
+                                             TscClock::nanosBetween(wsClient->lastMessageTicks(), TscClock::now()));
+        }
+
+        SpanTracer& tracer = SpanTracer::instance();
+        uint64_t traceId = nextTraceId.fetch_add(1, std::memory_order_relaxed);
+        if (traceIdOut) {
+            *traceIdOut = traceId;
+        }
+        tracer.asyncBegin("order", traceId);
+        auto tracedEncode = [&](uint64_t id) {
+            TraceSpan span("order.encode", traceId);
+            return encode(id);
         };
 
-        // private method => pass isPrivate = true
-        json response = apiClient.sendRequest(request, /*isPrivate*/ true);
+        json response;
+        if (wsClient && wsClient->isAuthenticated()) {
+            // The ack is tracked from the IO thread, so a reply that comes
+            // after we stop waiting still ties the order's fills to it
+            std::future<json> reply = wsClient->sendEncodedRpc(method, tracedEncode, traceId,
+                [this, traceId](const json& ack) { trackOrderAck(ack, traceId); });
+            TraceSpan wait("order.await_reply", traceId);
+            if (reply.wait_for(kWebSocketOrderTimeout) == std::future_status::ready) {
+                response = reply.get();
+            } else {
+                std::cerr << method << " timed out waiting for a WebSocket reply" << std::endl;
+                response = {{"timed_out", true}};
+            }
+        } else {
+            std::string_view body = tracedEncode(restId);
+            if (body.empty()) {
+                std::cerr << method << " failed: Invalid request parameters" << std::endl;
+            } else {
+                TraceSpan roundTrip("order.rest_roundtrip", traceId);
+                response = apiClient.sendRawRequest(std::string(body), /*isPrivate*/ true);
+            }
+            trackOrderAck(response, traceId);
+        }
+
+        tracer.asyncEnd("order", traceId);
+        return response;
+    }
+
+public:
+    // Route order entry over an authenticated WebSocket session
+    void setWebSocketClient(DeribitWebSocketClient* client) {
+        wsClient = client;
+    }
+
+    // Follow fills and closes of our orders (needs an authenticated
+    // WebSocket session); they show up in the trace under the order's id
+    void trackFills() {
+        if (!wsClient || !wsClient->isAuthenticated()) {
+            return;
+        }
+        const std::string tradesChannel = "user.trades.any.any.raw";
+        const std::string ordersChannel = "user.orders.any.any.raw";
+
+        wsClient->registerUserCallback(tradesChannel, [this](const UserNotification& notification) {
+            std::lock_guard<std::mutex> lock(workingOrdersMutex);
+            for (uint32_t i = 0; i < notification.count; ++i) {
+                auto it = workingOrders.find(std::string(notification.events[i].orderId));
+                if (it != workingOrders.end()) {
+                    SpanTracer::instance().instant("order.fill", it->second);
+                }
+            }
+        });
+        wsClient->registerUserCallback(ordersChannel, [this](const UserNotification& notification) {
+            std::lock_guard<std::mutex> lock(workingOrdersMutex);
+            for (uint32_t i = 0; i < notification.count; ++i) {
+                const OrderEvent& event = notification.events[i];
+                if (event.orderState != "filled" && event.orderState != "cancelled" &&
+                    event.orderState != "rejected") {
+                    continue;
+                }
+                auto it = workingOrders.find(std::string(event.orderId));
+                if (it != workingOrders.end()) {
+                    SpanTracer::instance().asyncEnd("order.working", it->second);
+                    workingOrders.erase(it);
+                }
+            }
+        });
+        wsClient->subscribe(tradesChannel);
+        wsClient->subscribe(ordersChannel);
+    }
+
+    // Place a limit order (side is "buy" or "sell"); 'traceIdOut' as for
+    // sendOrderRequest
+    bool placeOrder(const std::string& instrument, double price, double amount, const std::string& side = "buy",
+                    uint64_t* traceIdOut = nullptr) {
+        if (side != "buy" && side != "sell") {
+            std::cerr << "Order placement failed. Unknown side: " << side << std::endl;
+            return false;
+        }
+        bool buy = side == "buy";
+
+        json response = sendOrderRequest("private/" + side, 101, [&](uint64_t id) {
+            return orderEncoder.encodeLimitOrder(buy, instrument, price, amount, id);
+        }, traceIdOut);
+        if (outcomeUnknown(response)) {
+            reportUnknownOutcome("placement");
+            return false;
+        }
         if (response.contains("result")) {
             std::cout << "Order placed successfully. Full response:\n" 
                       << response.dump(2) << std::endl;
@@ -218,14 +356,13 @@ public:
 
     // Cancel an order
     bool cancelOrder(const std::string& orderId) {
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", 102},
-            {"method", "private/cancel"},
-            {"params", {{"order_id", orderId}}}
-        };
-
-        json response = apiClient.sendRequest(request, true);
+        json response = sendOrderRequest("private/cancel", 102, [&](uint64_t id) {
+            return orderEncoder.encodeCancel(orderId, id);
+        });
+        if (outcomeUnknown(response)) {
+            reportUnknownOutcome("cancellation");
+            return false;
+        }
         if (response.contains("result")) {
             std::cout << "Order cancelled successfully. Full response:\n"
                       << response.dump(2) << std::endl;
@@ -239,18 +376,13 @@ public:
 
     // Modify an existing order
     bool modifyOrder(const std::string& orderId, double newPrice, double newAmount) {
-        json request = {
-            {"jsonrpc", "2.0"},
-            {"id", 103},
-            {"method", "private/edit"},
-            {"params", {
-                {"order_id", orderId},
-                {"price", newPrice},
-                {"amount", newAmount}
-            }}
-        };
-
-        json response = apiClient.sendRequest(request, true);
+        json response = sendOrderRequest("private/edit", 103, [&](uint64_t id) {
+            return orderEncoder.encodeEdit(orderId, newPrice, newAmount, id);
+        });
+        if (outcomeUnknown(response)) {
+            reportUnknownOutcome("modification");
+            return false;
+        }
         if (response.contains("result")) {
             std::cout << "Order modified successfully. Full response:\n"
                       << response.dump(2) << std::endl;
@@ -263,13 +395,17 @@ public:
     }
 
     // Public call: get order book for a specific instrument
-    json getOrderBook(const std::string& instrument) {
+    // (depth 0 keeps the exchange default)
+    json getOrderBook(const std::string& instrument, int depth = 0) {
         json request = {
             {"jsonrpc", "2.0"},
             {"id", 104},
             {"method", "public/get_order_book"},
             {"params", {{"instrument_name", instrument}}}
         };
+        if (depth > 0) {
+            request["params"]["depth"] = depth;
+        }
         return apiClient.sendRequest(request, /*isPrivate*/ false);
     }
 
@@ -300,19 +436,22 @@ public:
     }
 
     // In the OrderManager class, add a method to measure end-to-end latency:
-    bool placeOrderWithLatencyMeasurement(const std::string& instrument, double price, double amount) {
-        auto start = std::chrono::high_resolution_clock::now();
+    bool placeOrderWithLatencyMeasurement(const std::string& instrument, double price, double amount,
+                                          const std::string& side = "buy") {
+        uint64_t start = TscClock::now();
         
         // Place the order
-        bool result = placeOrder(instrument, price, amount);
+        uint64_t traceId = 0;
+        bool result = placeOrder(instrument, price, amount, side, &traceId);
         
-        auto end = std::chrono::high_resolution_clock::now();
-        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        uint64_t end = TscClock::now();
+        auto latency = TscClock::microsBetween(start, end);
         
         std::cout << "End-to-end trading loop latency: " << latency << " microseconds" << std::endl;
         
-        // You could add a new category in PerformanceMonitor for this
-        // performanceMonitor.recordTradingLoopLatency(latency);
+        // The per-stage breakdown (encode, send, reply, fill) is in the
+        // order trace; the end-to-end span carries the same id
+        SpanTracer::instance().complete("order.end_to_end", start, end, traceId);
         
         return result;
     }
@@ -324,9 +463,89 @@ public:
 class MarketDataManager {
 private:
     DeribitWebSocketClient wsClient;
-    std::map<std::string, json> latestOrderBooks;
+
+    // One native book per subscribed instrument. The map itself is only
+    // touched at subscribe time; books are never erased, so pointers
+    // handed out by getOrderBook() stay valid for the manager's lifetime.
+    std::map<std::string, std::unique_ptr<OrderBook>> orderBooks;
     std::mutex orderBookMutex;
 
+    // Delta sequencing per instrument, plus the thread that fetches REST
+    // snapshots when a feed detects a change_id gap
+    std::map<std::string, std::unique_ptr<IncrementalBookFeed>> bookFeeds;
+    // The one book channel feeding each instrument's book: raw and 100ms
+    // have separate change_id sequences, so a feed can follow only one
+    std::map<std::string, std::string> bookChannels;
+    BookSnapshotFetcher snapshotFetcher;
+    std::unique_ptr<BookResyncWorker> resyncWorker;
+
+    // Local fan-out of book and trade updates (optional). Instruments a
+    // downstream client asked for are subscribed upstream once; those
+    // asked for while disconnected wait in fanoutPending until connected.
+    MarketDataServer* fanoutServer = nullptr;
+    std::set<std::string> fanoutInstruments;
+    std::set<std::string> fanoutPending;
+    std::mutex fanoutMutex;
+
+    // Book tops and trades for strategy processes on this host (optional)
+    ShmBusPublisher* shmBus = nullptr;
+
+    OrderBook* getOrCreateBook(const std::string& instrument) {
+        std::lock_guard<std::mutex> lock(orderBookMutex);
+        auto& book = orderBooks[instrument];
+        if (!book) {
+            book = std::make_unique<OrderBook>(instrument);
+        }
+        return book.get();
+    }
+
+    IncrementalBookFeed* getOrCreateFeed(const std::string& instrument, OrderBook& book) {
+        std::lock_guard<std::mutex> lock(orderBookMutex);
+        if (!resyncWorker) {
+            resyncWorker = std::make_unique<BookResyncWorker>(snapshotFetcher);
+        }
+        auto& feed = bookFeeds[instrument];
+        if (!feed) {
+            feed = std::make_unique<IncrementalBookFeed>(book, *resyncWorker);
+        }
+        return feed.get();
+    }
+
+    // Caller holds fanoutMutex
+    void subscribeForFanout(const std::string& instrument) {
+        if (fanoutInstruments.count(instrument)) {
+            return;
+        }
+        if (!isConnected()) {
+            fanoutPending.insert(instrument);
+            std::cout << "Fan-out subscription to " << instrument
+                      << " will start once the WebSocket connects" << std::endl;
+            return;
+        }
+        if (subscribeOrderBook(instrument) && subscribeTrades(instrument)) {
+            fanoutInstruments.insert(instrument);
+            fanoutPending.erase(instrument);
+        } else {
+            fanoutPending.insert(instrument);
+        }
+    }
+
+    // Connection callback (IO thread). Upstream subscriptions end with the
+    // connection, so on a drop everything goes back to pending.
+    void onFanoutConnection(bool connected) {
+        std::lock_guard<std::mutex> lock(fanoutMutex);
+        if (!connected) {
+            fanoutPending.insert(fanoutInstruments.begin(), fanoutInstruments.end());
+            fanoutInstruments.clear();
+            return;
+        }
+        std::set<std::string> pending;
+        pending.swap(fanoutPending);
+        for (const std::string& instrument : pending) {
+            subscribeForFanout(instrument);
+        }
+    }
+
 public:
     MarketDataManager(const std::string& clientId, const std::string& clientSecret, PerformanceMonitor& pm) 
         : wsClient(clientId, clientSecret, pm) {
@@ -338,7 +557,45 @@ public:
             } else {
                 std::cout << "WebSocket disconnected" << std::endl;
             }
+            if (fanoutServer) {
+                onFanoutConnection(connected);
+            }
+        });
+    }
+
+    ~MarketDataManager() {
+        // Stop the IO thread before the books and feeds it writes to go away
+        wsClient.disconnect();
+    }
+
+    // Set how full book snapshots are fetched when a feed needs to resync.
+    // Must be called before the first order book subscription.
+    void setSnapshotFetcher(BookSnapshotFetcher fetcher) {
+        std::lock_guard<std::mutex> lock(orderBookMutex);
+        snapshotFetcher = std::move(fetcher);
+    }
+
+    // Republish updates on 'server'. Must be called before subscribing;
+    // the server must outlive this manager's WebSocket connection.
+    void setFanoutServer(MarketDataServer* server) {
+        fanoutServer = server;
+        if (!server) {
+            return;
+        }
+        // Slow clients are resynced from the books this manager keeps
+        server->setBookSource([this](const std::string& instrument) {
+            return getOrderBook(instrument);
         });
+        server->setFirstSubscriberHandler([this](const std::string& instrument) {
+            std::lock_guard<std::mutex> lock(fanoutMutex);
+            subscribeForFanout(instrument);
+        });
+    }
+
+    // Also write book tops and trades to 'bus'. Must be called before
+    // connecting; the bus must outlive this manager's WebSocket connection.
+    void setShmPublisher(ShmBusPublisher* bus) {
+        shmBus = bus;
     }
 
     // Connect to WebSocket server
@@ -351,23 +608,62 @@ public:
         wsClient.disconnect();
     }
 
-    // Subscribe to order book updates for an instrument
-    bool subscribeOrderBook(const std::string& instrument) {
-        std::string channel = "book." + instrument + ".100ms";
+    // Subscribe to order book updates for an instrument.
+    // raw = true uses the tick-by-tick book.<instrument>.raw feed instead
+    // of the 100ms conflated one; both are applied as sequenced deltas.
+    // An instrument keeps the first channel it was subscribed on: a later
+    // request for the other one subscribes that channel again instead.
+    bool subscribeOrderBook(const std::string& instrument, bool raw = false) {
+        std::string channel = "book." + instrument + (raw ? ".raw" : ".100ms");
+        {
+            std::lock_guard<std::mutex> lock(orderBookMutex);
+            auto existing = bookChannels.emplace(instrument, channel).first;
+            if (existing->second != channel) {
+                std::cout << existing->second << " already feeds the " << instrument
+                          << " book; not adding " << channel << std::endl;
+                channel = existing->second;
+            }
+        }
+        OrderBook* book = getOrCreateBook(instrument);
+        IncrementalBookFeed* feed = getOrCreateFeed(instrument, *book);
         
         // Register callback for this channel
-        wsClient.registerCallback(channel, [this, instrument](const json& data) {
+        wsClient.registerBookCallback(channel, [this, book, feed, instrument](const BookNotification& update) {
             try {
-                // Process and store order book update
-                std::lock_guard<std::mutex> lock(orderBookMutex);
-                latestOrderBooks[instrument] = data["params"]["data"];
+                // Apply the delta to the native book, resyncing on gaps
+                uint64_t applyStart = TscClock::now();
+                BookFeedResult result;
+                {
+                    AllocScope allocScope(AllocTag::Books);
+                    HotPathScope hotPath;
+                    result = feed->onUpdate(update.view());
+                }
+                performanceMonitor.recordLatency(LatencyMetric::BookApply,
+                                                 TscClock::nanosBetween(applyStart, TscClock::now()));
+
+                // Downstream sees exactly the sequence of states our book goes through
+                if (fanoutServer && result == BookFeedResult::Applied) {
+                    fanoutServer->publishBook(instrument, update.view(), book->getUpdateCount());
+                } else if (fanoutServer && result == BookFeedResult::Resynced) {
+                    fanoutServer->publishBookSnapshot(instrument, *book);
+                }
+                if (shmBus && result != BookFeedResult::Buffered) {
+                    PriceLevel bids[kShmTopLevels];
+                    PriceLevel asks[kShmTopLevels];
+                    size_t bidCount = book->depth(BookSide::Bid, bids, kShmTopLevels);
+                    size_t askCount = book->depth(BookSide::Ask, asks, kShmTopLevels);
+                    shmBus->publishBookTop(instrument, book->getTimestamp(), book->getChangeId(),
+                                           book->getUpdateCount(), bids, bidCount, asks, askCount);
+                }
                 
                 // Print some basic info about the update
-                auto& book = data["params"]["data"];
+                PriceLevel bid, ask;
+                bool hasBid = book->bestBid(bid);
+                bool hasAsk = book->bestAsk(ask);
                 std::cout << "Order book update for " << instrument << ": "
-                          << "Timestamp: " << book["timestamp"] << ", "
-                          << "Best bid: " << (book["bids"].empty() ? "none" : book["bids"][0][0].dump()) << ", "
-                          << "Best ask: " << (book["asks"].empty() ? "none" : book["asks"][0][0].dump()) << std::endl;
+                          << "Timestamp: " << book->getTimestamp() << ", "
+                          << "Best bid: " << (hasBid ? std::to_string(fromFixedPrice(bid.price)) : "none") << ", "
+                          << "Best ask: " << (hasAsk ? std::to_string(fromFixedPrice(ask.price)) : "none") << std::endl;
             } catch (const std::exception& e) {
                 std::cerr << "Error processing order book update: " << e.what() << std::endl;
             }
@@ -380,25 +676,46 @@ public:
     bool subscribeTrades(const std::string& instrument) {
         std::string channel = "trades." + instrument + ".100ms";
         
-        wsClient.registerCallback(channel, [instrument](const json& data) {
+        wsClient.registerTradesCallback(channel, [this, instrument](const TradesNotification& update) {
+            if (fanoutServer) {
+                fanoutServer->publishTrades(instrument, update);
+            }
+            if (shmBus) {
+                for (uint32_t i = 0; i < update.count; ++i) {
+                    const TradeEntry& trade = update.trades[i];
+                    shmBus->publishTrade(instrument, trade.tradeId.data(), trade.tradeId.size(), trade.price,
+                                         trade.amount, static_cast<uint8_t>(trade.direction), trade.timestamp,
+                                         trade.tradeSeq);
+                }
+            }
+
             // Process trade data
-            for (const auto& trade : data["params"]["data"]) {
+            for (uint32_t i = 0; i < update.count; ++i) {
+                const TradeEntry& trade = update.trades[i];
                 std::cout << "Trade on " << instrument << ": "
-                          << "Price: " << trade["price"] << ", "
-                          << "Amount: " << trade["amount"] << ", "
-                          << "Direction: " << trade["direction"] << std::endl;
+                          << "Price: " << fromFixedPrice(trade.price) << ", "
+                          << "Amount: " << trade.amount << ", "
+                          << "Direction: " << (trade.direction == TradeDirection::Buy ? "buy" : "sell") << std::endl;
             }
         });
         
         return wsClient.subscribe(channel);
     }
 
-    // Get the latest order book for an instrument
-    json getLatestOrderBook(const std::string& instrument) {
+    // Get the native book for an instrument (nullptr if never subscribed).
+    // Strategies should look this up once and keep the pointer; all
+    // queries on it are lock-free.
+    const OrderBook* getOrderBook(const std::string& instrument) {
         std::lock_guard<std::mutex> lock(orderBookMutex);
-        auto it = latestOrderBooks.find(instrument);
-        if (it != latestOrderBooks.end()) {
-            return it->second;
+        auto it = orderBooks.find(instrument);
+        return it != orderBooks.end() ? it->second.get() : nullptr;
+    }
+
+    // Get the latest order book for an instrument rendered as JSON
+    json getLatestOrderBook(const std::string& instrument) {
+        const OrderBook* book = getOrderBook(instrument);
+        if (book) {
+            return book->toJson();
         }
         return json();
     }
@@ -407,6 +724,11 @@ public:
     bool isConnected() const {
         return wsClient.isConnected();
     }
+
+    // The underlying socket, shared with OrderManager for order entry
+    DeribitWebSocketClient& getWebSocketClient() {
+        return wsClient;
+    }
 };
 
 // --------------------------------------------------------------------
@@ -418,6 +740,7 @@ private:
     MarketDataManager marketDataManager;
     std::atomic<bool> running{true};
     std::thread marketDataThread;
+    MarketDataServer* fanoutServer = nullptr;
 
     void clearScreen() {
         // Clear screen - works on most terminals
@@ -454,7 +777,8 @@ private:
         
         std::cout << BOLD << "┌─ " << CYAN << "SYSTEM" << RESET << BOLD << " ────────────────────────────────────────┐" << RESET << std::endl;
         std::cout << BOLD << "│" << RESET << " " << YELLOW << "10" << RESET << ". View Performance Statistics                           " << BOLD << "│" << RESET << std::endl;
-        std::cout << BOLD << "│" << RESET << " " << YELLOW << "11" << RESET << ". Exit                                                  " << BOLD << "│" << RESET << std::endl;
+        std::cout << BOLD << "│" << RESET << " " << YELLOW << "11" << RESET << ". Record / Dump Order Trace                             " << BOLD << "│" << RESET << std::endl;
+        std::cout << BOLD << "│" << RESET << " " << YELLOW << "12" << RESET << ". Exit                                                  " << BOLD << "│" << RESET << std::endl;
         std::cout << BOLD << "└────────────────────────────────────────────────────────┘" << RESET << std::endl;
         std::cout << std::endl;
         
@@ -492,6 +816,25 @@ private:
 public:
     TradingCLI(PerformanceMonitor& pm) : marketDataManager("37SSZh4R", "GJbkkwiwElUtOPZKolJ5SXjQHgh4vuVxMOmrqC534Yw", pm) {
         // Initialize with the same credentials as REST API
+
+        // Orders go over the WebSocket once it is connected and authenticated
+        orderManager.setWebSocketClient(&marketDataManager.getWebSocketClient());
+
+        // Book resyncs fetch full-depth snapshots over REST
+        marketDataManager.setSnapshotFetcher([this](const std::string& instrument) {
+            return orderManager.getOrderBook(instrument, static_cast<int>(OrderBook::kMaxLevels));
+        });
+    }
+
+    // Republish the market data this client receives to local subscribers
+    void setFanoutServer(MarketDataServer* server) {
+        fanoutServer = server;
+        marketDataManager.setFanoutServer(server);
+    }
+
+    // Publish book tops and trades to co-located processes
+    void setShmPublisher(ShmBusPublisher* bus) {
+        marketDataManager.setShmPublisher(bus);
     }
 
     ~TradingCLI() {
@@ -523,7 +866,8 @@ public:
                 case 8: handleSubscribeOrderBook(); break;
                 case 9: handleSubscribeTrades(); break;
                 case 10: handleViewPerformance(); break;
-                case 11: 
+                case 11: handleOrderTrace(); break;
+                case 12: 
                     printInfo("Exiting...");
                     running = false;
                     return;
@@ -539,11 +883,18 @@ public:
         
         std::string instrument;
         int quantity;
+        std::string side;
         std::string type;
         double price = 0.0;
 
         std::cout << BOLD << "Enter instrument (e.g., ETH-PERPETUAL): " << RESET;
         std::getline(std::cin, instrument);
+
+        std::cout << BOLD << "Enter side (buy/sell): " << RESET;
+        std::cin >> side;
+        if (side != "sell") {
+            side = "buy";
+        }
         
         std::cout << BOLD << "Enter quantity: " << RESET;
         std::cin >> quantity;
@@ -559,7 +910,7 @@ public:
         std::cout << std::endl << BOLD << "Placing order..." << RESET << std::endl;
 
         // Place the order using OrderManager
-        bool result = orderManager.placeOrderWithLatencyMeasurement(instrument, price, quantity);
+        bool result = orderManager.placeOrderWithLatencyMeasurement(instrument, price, quantity, side);
         
         if (result) {
             printSuccess("Order placed successfully.");
@@ -776,6 +1127,8 @@ public:
         
         if (marketDataManager.isConnected()) {
             printSuccess("Successfully connected to WebSocket server.");
+            // Fill notifications close out traced orders
+            orderManager.trackFills();
         } else {
             printError("Failed to connect to WebSocket server.");
         }
@@ -795,9 +1148,13 @@ public:
         std::string instrument;
         std::cout << BOLD << "Instrument to subscribe to order book (e.g., BTC-PERPETUAL): " << RESET;
         std::getline(std::cin, instrument);
+
+        std::string feedType;
+        std::cout << BOLD << "Use tick-by-tick raw feed? (y/n): " << RESET;
+        std::getline(std::cin, feedType);
         
         printInfo("Subscribing to order book updates...");
-        bool success = marketDataManager.subscribeOrderBook(instrument);
+        bool success = marketDataManager.subscribeOrderBook(instrument, feedType == "y" || feedType == "Y");
         
         if (success) {
             printSuccess("Subscribed to order book updates.");
@@ -837,9 +1194,39 @@ public:
         waitForKeyPress();
     }
 
+    // Machine-readable copy of the statistics for scripts and dashboards
+    static void writePerformanceReport(const std::string& path = "performance_stats.json") {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Could not write " << path << std::endl;
+            return;
+        }
+        out << performanceMonitor.exportJson() << std::endl;
+        std::cout << "Statistics written to " << path << std::endl;
+    }
+
     void handleViewPerformance() {
         printSectionHeader("PERFORMANCE STATISTICS");
         performanceMonitor.printStatistics();
+        if (fanoutServer) {
+            fanoutServer->printClientStats();
+        }
+        writePerformanceReport();
+        waitForKeyPress();
+    }
+
+    // First use starts recording; later uses write what has been recorded
+    void handleOrderTrace() {
+        printSectionHeader("ORDER TRACE");
+        SpanTracer& tracer = SpanTracer::instance();
+        if (!tracer.enabled()) {
+            tracer.setEnabled(true);
+            printSuccess("Order tracing enabled. Place some orders, then choose this option again.");
+        } else if (tracer.dumpChromeTrace("order_trace.json")) {
+            printSuccess("Trace written to order_trace.json (open in chrome://tracing or ui.perfetto.dev).");
+        } else {
+            printError("Failed to write order trace.");
+        }
         waitForKeyPress();
     }
 };
@@ -847,23 +1234,89 @@ public:
 // Update the main function to include the new terminal styling
 int main() {
     std::cout << BOLD << CYAN << "Starting Deribit Trading Client with performance monitoring..." << RESET << std::endl;
-    
-    // Start a thread to periodically check memory usage
-    std::thread memoryMonitorThread([]() {
-        while (true) {
-            performanceMonitor.checkMemoryUsage();
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-        }
-    });
-    memoryMonitorThread.detach(); // Detach memory monitor thread
-    
+
+    // Calibrate the timestamp clock before anything is measured
+    TscClock::init();
+    std::cout << "Timestamp source: " << (TscClock::usingTsc() ? "invariant TSC at " : "steady_clock")
+              << (TscClock::usingTsc() ? std::to_string(TscClock::ticksPerNano()) + " GHz" : "") << std::endl;
+    DeribitEndpoints endpoints = DeribitEndpoints::fromEnvironment();
+    std::cout << "REST endpoint: " << endpoints.restUrl << "\nWebSocket endpoint: " << endpoints.wsUrl << std::endl;
+
+    if (AllocTracker::enabled()) {
+        std::cout << "Heap allocation tracking enabled" << std::endl;
+    }
+
+    // DERIBIT_HW_COUNTERS=1 samples perf_event counters around feed
+    // messages and order requests (adds two syscalls to each)
+    const char* hwCountersEnv = std::getenv("DERIBIT_HW_COUNTERS");
+    if (hwCountersEnv && std::string(hwCountersEnv) != "0" && performanceMonitor.enableHardwareCounters()) {
+        std::cout << "Hardware performance counters enabled" << std::endl;
+    }
+
+    // DERIBIT_TRACE=1 records order spans from startup (dumped at exit)
+    const char* traceEnv = std::getenv("DERIBIT_TRACE");
+    bool traceOrders = traceEnv && std::string(traceEnv) != "0";
+    SpanTracer::instance().setThreadName("cli");
+    SpanTracer::instance().setEnabled(traceOrders);
+
+    // WebSocket fan-out of books and trades to local clients, started
+    // once the CLI is wired to it; DERIBIT_FANOUT_PORT=0 disables it
+    const char* fanoutPortEnv = std::getenv("DERIBIT_FANOUT_PORT");
+    int fanoutPort = fanoutPortEnv ? std::atoi(fanoutPortEnv) : 9465;
+    std::unique_ptr<MarketDataServer> fanoutServer;
+    if (fanoutPort > 0 && fanoutPort <= 65535) {
+        fanoutServer = std::make_unique<MarketDataServer>(static_cast<uint16_t>(fanoutPort));
+    }
+
+    // Shared-memory bus for strategy processes (/dev/shm/<name>, read with
+    // ShmBusReader); DERIBIT_SHM_BUS=0 disables it
+    const char* shmBusEnv = std::getenv("DERIBIT_SHM_BUS");
+    std::string shmBusName = shmBusEnv && *shmBusEnv ? shmBusEnv : "deribit_md";
+    ShmBusPublisher shmBus;
+    if (shmBusName != "0") {
+        std::string error;
+        if (shmBus.create(shmBusName, kShmDefaultSlots, &error)) {
+            std::cout << "Shared-memory market data bus: /dev/shm/" << shmBusName << std::endl;
+        } else {
+            std::cerr << "Cannot create shared-memory bus " << shmBusName << ": " << error << std::endl;
+        }
+    }
+
+    // Prometheus endpoint on localhost; DERIBIT_METRICS_PORT=0 disables it
+    const char* metricsPortEnv = std::getenv("DERIBIT_METRICS_PORT");
+    int metricsPort = metricsPortEnv ? std::atoi(metricsPortEnv) : 9464;
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (metricsPort > 0 && metricsPort <= 65535) {
+        metricsServer = std::make_unique<MetricsServer>(performanceMonitor, static_cast<uint16_t>(metricsPort));
+        if (fanoutServer) {
+            MarketDataServer* fanout = fanoutServer.get();
+            metricsServer->addSource([fanout]() { return fanout->exportPrometheus(); });
+        }
+        metricsServer->start();
+    }
    
     // Simple CLI demonstration
     TradingCLI tradingCLI(performanceMonitor);
+    if (shmBus.isOpen()) {
+        tradingCLI.setShmPublisher(&shmBus);
+    }
+    if (fanoutServer) {
+        tradingCLI.setFanoutServer(fanoutServer.get());
+        fanoutServer->start();
+    }
     tradingCLI.run();
+
+    // No more downstream subscribe requests into the CLI's market data
+    if (fanoutServer) {
+        fanoutServer->stop();
+    }
     
     // Print performance statistics before exiting
     performanceMonitor.printStatistics();
+    TradingCLI::writePerformanceReport();
+    if (SpanTracer::instance().enabled()) {
+        SpanTracer::instance().dumpChromeTrace("order_trace.json");
+    }
     
     return 0;
 }
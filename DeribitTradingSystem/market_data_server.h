@@ -0,0 +1,952 @@
+#ifndef MARKET_DATA_SERVER_H
+#define MARKET_DATA_SERVER_H
+
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "order_book.h"
+#include "notification_parser.h"
+#include "rcu_ptr.h"
+#include "string_format.h"
+#include "wire_format.h"
+
+// How the fan-out treats a client that reads slower than updates arrive
+struct SlowConsumerPolicy {
+    // Once this many bytes wait in a client's send buffer its book
+    // updates are conflated instead of queued; it goes live again once
+    // the buffer drains below half of this
+    size_t conflateAboveBytes = 256 * 1024;
+    // Trade batches held per conflating client; beyond this the oldest are dropped
+    size_t maxPendingTrades = 256;
+    // Close the client instead of dropping trades
+    bool disconnectOnTradeOverflow = false;
+    // Close the client when its send buffer exceeds this (0 = never)...
+    size_t disconnectAboveBytes = 16 * 1024 * 1024;
+    // ...or when it has been conflating for this long (0 = never)
+    uint32_t disconnectAfterLagMs = 10000;
+    // How often conflated state is flushed to clients that caught up
+    uint32_t flushIntervalMs = 20;
+};
+
+// One downstream client, as seen by clientStats()
+struct FanoutClientStats {
+    std::string remote;
+    size_t subscriptions = 0;
+    size_t bufferedBytes = 0;   // in its send buffer, not yet written to the socket
+    bool conflating = false;
+    double lagMs = 0.0;         // how long its conflated state has been waiting
+    double maxLagMs = 0.0;
+    uint64_t framesSent = 0;
+    uint64_t conflatedUpdates = 0;  // book updates folded into a later snapshot
+    uint64_t snapshotsSent = 0;     // on joining and on catching up
+    uint64_t droppedTrades = 0;     // trade batches
+};
+
+// --------------------------------------------------------------------
+// MarketDataServer: local WebSocket fan-out of normalized market data
+//   Downstream clients connect to ws://127.0.0.1:<port> and send
+//     {"id":1,"method":"subscribe","params":{"instruments":["BTC-PERPETUAL"]}}
+//   ("unsubscribe" takes the same params). They then receive
+//     {"type":"book","instrument":..,"seq":..,"timestamp":..,"change_id":..,
+//      "snapshot":true|false,"bids":[[price,amount],..],"asks":[..]}
+//   and
+//     {"type":"trades","instrument":..,"trades":[{"trade_id":..,"price":..,
+//      "amount":..,"direction":"buy"|"sell","timestamp":..}]}
+//
+//   A client that adds "format":"binary" to its first subscribe gets the
+//   same updates as binary frames in the wire format (wire_format.h)
+//   instead: BookDelta / BookSnapshot messages, and one frame of Trade
+//   messages per batch. Each instrument's Instrument message comes
+//   before anything else about it. Replies stay JSON text.
+//
+//   Book protocol: a new subscriber is sent a snapshot of the in-process
+//   book right away (or the exchange's first snapshot, if the book has
+//   none yet), then deltas numbered seq+1, seq+2, ... A snapshot may
+//   arrive at any time and replaces the book, deltas included; amount 0
+//   removes a level. A gap in seq means the client missed an update and
+//   should unsubscribe and subscribe again.
+//
+//   Each update is serialized and framed once, into a single immutable
+//   WebSocket message that every subscribed connection queues by
+//   reference, so the cost per extra subscriber is a queue push and its
+//   share of the socket write, not an encode and a copy.
+//
+//   Slow clients: once a client's send buffer passes the policy
+//   threshold, its book deltas are no longer queued. Its subscriptions
+//   are only marked stale; once it drains, the server thread resyncs it
+//   exactly like a new subscriber. Snapshots are rendered once per
+//   instrument per resync pass, whoever they go to. Trades are held in a
+//   bounded queue. Clients that stay behind are disconnected.
+//
+//   publish*() must be called from one thread (the upstream WebSocket IO
+//   thread). Its subscriber lookup is an RCU read, and the only lock it
+//   takes is the client's mailbox lock, which the server thread holds
+//   just long enough to queue frames; it never waits on a socket.
+//
+//   websocketpp's get_buffered_amount() reads the send buffer size
+//   without the connection's write lock. Only the server thread calls
+//   it, under the mailbox lock: that excludes the publisher's sends, and
+//   the server thread is the one completing writes. Everyone else reads
+//   the copy it leaves in ClientSession::bufferedBytes, refreshed every
+//   flushIntervalMs, so a client is seen backing up at most that late.
+// --------------------------------------------------------------------
+class MarketDataServer {
+public:
+    using server = websocketpp::server<websocketpp::config::asio>;
+    using message_type = websocketpp::config::asio::message_type;
+    using message_ptr = server::message_ptr;
+
+    // Called (on the server thread) when an instrument gets its first
+    // downstream subscriber, so the caller can subscribe upstream
+    using FirstSubscriberHandler = std::function<void(const std::string& instrument)>;
+    // Current in-process book of an instrument (nullptr if there is none)
+    using BookSource = std::function<const OrderBook*(const std::string& instrument)>;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct ClientSession;
+
+    enum class BookSync : uint8_t {
+        Stale,      // client has no usable book: deltas are dropped
+        Resyncing,  // snapshot being prepared: deltas are held for it
+        Live        // deltas are sent
+    };
+
+    // One client's subscription to one instrument. Holds the client so a
+    // table the publisher still reads keeps it alive; the client drops
+    // its subscriptions on close to break the cycle.
+    struct Subscription {
+        std::shared_ptr<ClientSession> client;
+        std::string instrument;
+        uint32_t instrumentId = 0;   // in binary frames
+        // Guarded by client->mailboxMutex
+        BookSync sync = BookSync::Stale;
+        uint64_t lastSeq = 0;        // last book update the client was sent
+        std::vector<std::pair<uint64_t, message_ptr>> heldDeltas;
+    };
+
+    struct ClientSession {
+        websocketpp::connection_hdl hdl;
+        server::connection_ptr connection;
+        std::string remote;
+        // Send buffer size, sampled by the server thread
+        std::atomic<size_t> bufferedBytes{0};
+        // Sent binary frames; only changes while it has no subscriptions
+        std::atomic<bool> binary{false};
+
+        // Server thread only
+        std::map<std::string, std::shared_ptr<Subscription>> subscriptions;
+        std::atomic<size_t> subscriptionCount{0};
+
+        // Mailbox, shared by the publishing and server threads
+        std::mutex mailboxMutex;
+        bool closed = false;
+        bool conflating = false;     // send buffer backed up; books go stale
+        bool evict = false;          // trade overflow under disconnectOnTradeOverflow
+        Clock::time_point conflatingSince;
+        std::deque<message_ptr> pendingTrades;
+
+        std::atomic<uint64_t> framesSent{0};
+        std::atomic<uint64_t> conflatedUpdates{0};
+        std::atomic<uint64_t> snapshotsSent{0};
+        std::atomic<uint64_t> droppedTrades{0};
+        std::atomic<int64_t> maxLagMicros{0};
+    };
+
+    using Subscribers = std::vector<std::shared_ptr<Subscription>>;
+    // instrument -> its subscriptions
+    using SubscriberTable = std::unordered_map<std::string, Subscribers>;
+
+    server endpoint;
+    uint16_t port;
+    SlowConsumerPolicy policy;
+    std::thread serverThread;
+    std::atomic<bool> running{false};
+
+    RcuPtr<SubscriberTable> subscriberTable;
+
+    // Written on the server thread; locked so clientStats() can read it
+    std::map<websocketpp::connection_hdl, std::shared_ptr<ClientSession>,
+             std::owner_less<websocketpp::connection_hdl>> sessions;
+    mutable std::mutex sessionsMutex;
+
+    FirstSubscriberHandler onFirstSubscriber;
+    BookSource bookSource;
+
+    // Wire ids of instruments, for binary clients (server thread only)
+    InstrumentRegistry instrumentIds;
+
+    // Snapshot buffers for the server thread and the publishing thread
+    std::unique_ptr<OrderBook::Snapshot> resyncSnapshot = std::make_unique<OrderBook::Snapshot>();
+    std::unique_ptr<OrderBook::Snapshot> publishSnapshot = std::make_unique<OrderBook::Snapshot>();
+
+    std::atomic<uint64_t> messagesPublished{0};
+    std::atomic<uint64_t> framesQueued{0};
+    std::atomic<uint64_t> conflatedUpdates{0};
+    std::atomic<uint64_t> snapshotsSent{0};
+    std::atomic<uint64_t> droppedTrades{0};
+    std::atomic<uint64_t> slowDisconnects{0};
+
+    // Frames 'payload' once as an unmasked server message. Marked as
+    // prepared, websocketpp sends it as is on every connection instead of
+    // framing a private copy for each.
+    static message_ptr prepareFrame(const std::string& payload,
+                                    websocketpp::frame::opcode::value opcode = websocketpp::frame::opcode::text) {
+        auto msg = websocketpp::lib::make_shared<message_type>(message_type::con_msg_man_ptr(), opcode, payload.size());
+        websocketpp::frame::basic_header header(opcode, payload.size(), true, false);
+        websocketpp::frame::extended_header extended(payload.size());
+        msg->set_header(websocketpp::frame::prepare_header(header, extended));
+        msg->set_payload(payload);
+        msg->set_prepared(true);
+        return msg;
+    }
+
+    void sendText(websocketpp::connection_hdl hdl, const std::string& text) {
+        websocketpp::lib::error_code ec;
+        endpoint.send(hdl, text, websocketpp::frame::opcode::text, ec);
+    }
+
+    static std::string errorReply(const nlohmann::json& id, const std::string& message) {
+        return nlohmann::json{{"id", id}, {"error", message}}.dump();
+    }
+
+    std::shared_ptr<ClientSession> findSession(websocketpp::connection_hdl hdl) {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        auto it = sessions.find(hdl);
+        return it != sessions.end() ? it->second : nullptr;
+    }
+
+    std::vector<std::shared_ptr<ClientSession>> allSessions() const {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        std::vector<std::shared_ptr<ClientSession>> clients;
+        clients.reserve(sessions.size());
+        for (const auto& entry : sessions) {
+            clients.push_back(entry.second);
+        }
+        return clients;
+    }
+
+    // Server thread
+    void handleOpen(websocketpp::connection_hdl hdl) {
+        auto session = std::make_shared<ClientSession>();
+        session->hdl = hdl;
+        websocketpp::lib::error_code ec;
+        session->connection = endpoint.get_con_from_hdl(hdl, ec);
+        if (ec || !session->connection) {
+            return;
+        }
+        session->remote = session->connection->get_remote_endpoint();
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        sessions[hdl] = std::move(session);
+    }
+
+    // Server thread
+    void handleRequest(websocketpp::connection_hdl hdl, const std::string& payload) {
+        std::shared_ptr<ClientSession> session = findSession(hdl);
+        if (!session) {
+            return;
+        }
+        nlohmann::json request;
+        try {
+            request = nlohmann::json::parse(payload);
+        } catch (const std::exception&) {
+            sendText(hdl, errorReply(nullptr, "invalid JSON"));
+            return;
+        }
+        nlohmann::json id = request.contains("id") ? request["id"] : nlohmann::json(nullptr);
+        std::string method = request.value("method", "");
+        if (method != "subscribe" && method != "unsubscribe") {
+            sendText(hdl, errorReply(id, "unknown method, expected subscribe or unsubscribe"));
+            return;
+        }
+        if (!request.contains("params") || !request["params"].contains("instruments") ||
+            !request["params"]["instruments"].is_array()) {
+            sendText(hdl, errorReply(id, "params.instruments must be an array"));
+            return;
+        }
+
+        std::vector<std::string> instruments;
+        for (const auto& value : request["params"]["instruments"]) {
+            if (value.is_string() && !value.get<std::string>().empty()) {
+                instruments.push_back(value.get<std::string>());
+            }
+        }
+
+        bool subscribe = method == "subscribe";
+        if (subscribe && request["params"].contains("format")) {
+            const nlohmann::json& format = request["params"]["format"];
+            if (format != "json" && format != "binary") {
+                sendText(hdl, errorReply(id, "params.format must be \"json\" or \"binary\""));
+                return;
+            }
+            bool binary = format == "binary";
+            if (binary != session->binary.load(std::memory_order_relaxed)) {
+                if (!session->subscriptions.empty()) {
+                    sendText(hdl, errorReply(id, "format can only be changed before subscribing"));
+                    return;
+                }
+                session->binary.store(binary, std::memory_order_relaxed);
+            }
+        }
+        if (subscribe && session->binary.load(std::memory_order_relaxed)) {
+            // Ids go out before the table lists the client for them
+            std::string definitions;
+            for (const std::string& instrument : instruments) {
+                if (session->subscriptions.count(instrument) == 0) {
+                    appendWire(definitions, sizeof(WireInstrument), [&](uint8_t* out, size_t capacity) {
+                        return encodeWireInstrument(out, capacity, instrumentIds.idOf(instrument), instrument);
+                    });
+                }
+            }
+            if (!definitions.empty()) {
+                websocketpp::lib::error_code ec;
+                endpoint.send(hdl, definitions, websocketpp::frame::opcode::binary, ec);
+            }
+        }
+
+        std::vector<std::string> firstSubscribers;
+        subscriberTable.update([&](SubscriberTable& table) {
+            for (const std::string& instrument : instruments) {
+                Subscribers& subscribers = table[instrument];
+                auto owned = session->subscriptions.find(instrument);
+                if (subscribe && owned == session->subscriptions.end()) {
+                    if (subscribers.empty()) {
+                        firstSubscribers.push_back(instrument);
+                    }
+                    auto subscription = std::make_shared<Subscription>();
+                    subscription->client = session;
+                    subscription->instrument = instrument;
+                    subscription->instrumentId = instrumentIds.idOf(instrument);
+                    session->subscriptions.emplace(instrument, subscription);
+                    subscribers.push_back(std::move(subscription));
+                } else if (!subscribe && owned != session->subscriptions.end()) {
+                    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), owned->second),
+                                      subscribers.end());
+                    session->subscriptions.erase(owned);
+                }
+                if (subscribers.empty()) {
+                    table.erase(instrument);
+                }
+            }
+        });
+        session->subscriptionCount.store(session->subscriptions.size(), std::memory_order_relaxed);
+
+        sendText(hdl, nlohmann::json{{"id", id}, {"result", instruments}}.dump());
+        if (subscribe) {
+            // Books for the new subscriptions, without waiting for a tick
+            resync({session});
+        }
+        if (onFirstSubscriber) {
+            for (const std::string& instrument : firstSubscribers) {
+                onFirstSubscriber(instrument);
+            }
+        }
+    }
+
+    // Server thread
+    void handleClose(websocketpp::connection_hdl hdl) {
+        std::shared_ptr<ClientSession> session;
+        {
+            std::lock_guard<std::mutex> lock(sessionsMutex);
+            auto it = sessions.find(hdl);
+            if (it == sessions.end()) {
+                return;
+            }
+            session = std::move(it->second);
+            sessions.erase(it);
+        }
+        {
+            // The publisher may still hold a table that lists this client
+            std::lock_guard<std::mutex> lock(session->mailboxMutex);
+            session->closed = true;
+            session->pendingTrades.clear();
+        }
+        subscriberTable.update([&](SubscriberTable& table) {
+            for (const auto& owned : session->subscriptions) {
+                auto entry = table.find(owned.first);
+                if (entry == table.end()) {
+                    continue;
+                }
+                Subscribers& subscribers = entry->second;
+                subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), owned.second),
+                                  subscribers.end());
+                if (subscribers.empty()) {
+                    table.erase(entry);
+                }
+            }
+        });
+        session->subscriptions.clear();
+    }
+
+    // Server thread, caller holds client.mailboxMutex
+    static size_t sampleBuffered(ClientSession& client) {
+        size_t buffered = client.connection->get_buffered_amount();
+        client.bufferedBytes.store(buffered, std::memory_order_relaxed);
+        return buffered;
+    }
+
+    // Caller holds client.mailboxMutex. Switches the client to conflation
+    // if its send buffer has backed up; returns whether it is conflating.
+    bool checkBackedUp(ClientSession& client) {
+        if (!client.conflating && client.bufferedBytes.load(std::memory_order_relaxed) > policy.conflateAboveBytes) {
+            client.conflating = true;
+            client.conflatingSince = Clock::now();
+        }
+        return client.conflating;
+    }
+
+    void queueFrame(ClientSession& client, const message_ptr& frame) {
+        client.connection->send(frame);
+        client.framesSent.fetch_add(1, std::memory_order_relaxed);
+        framesQueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Caller holds the client's mailboxMutex
+    void deliverBook(Subscription& subscription, const message_ptr& frame, uint64_t seq, bool isSnapshot) {
+        ClientSession& client = *subscription.client;
+        if (checkBackedUp(client)) {
+            subscription.sync = BookSync::Stale;
+            subscription.heldDeltas.clear();
+            client.conflatedUpdates.fetch_add(1, std::memory_order_relaxed);
+            conflatedUpdates.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (isSnapshot) {
+            queueFrame(client, frame);
+            subscription.lastSeq = seq;
+            subscription.sync = BookSync::Live;
+            subscription.heldDeltas.clear();
+            return;
+        }
+        switch (subscription.sync) {
+            case BookSync::Stale:
+                return;
+            case BookSync::Resyncing:
+                subscription.heldDeltas.emplace_back(seq, frame);
+                return;
+            case BookSync::Live:
+                // Anything at or below lastSeq is already in a snapshot it was sent
+                if (seq > subscription.lastSeq) {
+                    queueFrame(client, frame);
+                    subscription.lastSeq = seq;
+                }
+                return;
+        }
+    }
+
+    static std::string renderSnapshot(const std::string& instrument, const OrderBook::Snapshot& book) {
+        nlohmann::json bids = nlohmann::json::array();
+        nlohmann::json asks = nlohmann::json::array();
+        for (size_t i = 0; i < book.bidCount; ++i) {
+            bids.push_back({fromFixedPrice(book.bids[i].price), book.bids[i].amount});
+        }
+        for (size_t i = 0; i < book.askCount; ++i) {
+            asks.push_back({fromFixedPrice(book.asks[i].price), book.asks[i].amount});
+        }
+        return nlohmann::json{
+            {"type", "book"},
+            {"instrument", instrument},
+            {"seq", book.updateCount},
+            {"timestamp", book.timestamp},
+            {"change_id", book.changeId},
+            {"snapshot", true},
+            {"bids", bids},
+            {"asks", asks}
+        }.dump();
+    }
+
+    static std::string renderBinarySnapshot(uint32_t instrumentId, const OrderBook::Snapshot& book) {
+        std::string payload;
+        appendWire(payload, wireBookSize(book.bidCount + book.askCount), [&](uint8_t* out, size_t capacity) {
+            return encodeWireBook(out, capacity, instrumentId, true, book.updateCount, book.timestamp, book.changeId,
+                                  book.bids.data(), book.bidCount, book.asks.data(), book.askCount);
+        });
+        return payload;
+    }
+
+    // Server thread: sends each stale subscription of 'clients' (whose
+    // client is not backed up) a snapshot of the current book, then the
+    // deltas that arrived while it was being prepared, and puts it live.
+    // Ordering: deltas are held before the book is read, so every update
+    // missing from the snapshot is among the held ones (newer seq).
+    void resync(const std::vector<std::shared_ptr<ClientSession>>& clients) {
+        std::vector<std::shared_ptr<Subscription>> resyncing;
+        for (const auto& client : clients) {
+            std::lock_guard<std::mutex> lock(client->mailboxMutex);
+            if (client->closed) {
+                continue;
+            }
+            if (client->conflating) {
+                if (sampleBuffered(*client) > policy.conflateAboveBytes / 2) {
+                    continue;
+                }
+                // Caught up
+                client->conflating = false;
+                for (const message_ptr& frame : client->pendingTrades) {
+                    queueFrame(*client, frame);
+                }
+                client->pendingTrades.clear();
+            }
+            for (const auto& owned : client->subscriptions) {
+                if (owned.second->sync == BookSync::Stale) {
+                    owned.second->sync = BookSync::Resyncing;
+                    resyncing.push_back(owned.second);
+                }
+            }
+        }
+        if (resyncing.empty()) {
+            return;
+        }
+
+        // One snapshot per instrument and format, shared by every client in this pass
+        struct SnapshotFrame {
+            uint32_t instrumentId = 0;
+            bool needJson = false;
+            bool needBinary = false;
+            message_ptr json;    // null if there is no book to send yet
+            message_ptr binary;
+            uint64_t seq = 0;
+        };
+        std::unordered_map<std::string, SnapshotFrame> snapshots;
+        for (const auto& subscription : resyncing) {
+            SnapshotFrame& entry = snapshots[subscription->instrument];
+            entry.instrumentId = subscription->instrumentId;
+            if (subscription->client->binary.load(std::memory_order_relaxed)) {
+                entry.needBinary = true;
+            } else {
+                entry.needJson = true;
+            }
+        }
+        for (auto& snapshot : snapshots) {
+            SnapshotFrame& entry = snapshot.second;
+            const OrderBook* book = bookSource ? bookSource(snapshot.first) : nullptr;
+            if (!book) {
+                continue;
+            }
+            book->snapshot(*resyncSnapshot);
+            if (resyncSnapshot->updateCount == 0) {
+                continue;
+            }
+            entry.seq = resyncSnapshot->updateCount;
+            if (entry.needJson) {
+                entry.json = prepareFrame(renderSnapshot(snapshot.first, *resyncSnapshot));
+            }
+            if (entry.needBinary) {
+                entry.binary = prepareFrame(renderBinarySnapshot(entry.instrumentId, *resyncSnapshot),
+                                            websocketpp::frame::opcode::binary);
+            }
+        }
+
+        for (const auto& subscription : resyncing) {
+            ClientSession& client = *subscription->client;
+            std::lock_guard<std::mutex> lock(client.mailboxMutex);
+            if (client.closed || subscription->sync != BookSync::Resyncing) {
+                continue;  // gone, backed up again, or sent an exchange snapshot meanwhile
+            }
+            const SnapshotFrame& snapshot = snapshots[subscription->instrument];
+            const message_ptr& frame = client.binary.load(std::memory_order_relaxed) ? snapshot.binary : snapshot.json;
+            if (!frame) {
+                // Nothing to send yet; the exchange's first snapshot will do
+                subscription->sync = BookSync::Stale;
+                subscription->heldDeltas.clear();
+                continue;
+            }
+            queueFrame(client, frame);
+            subscription->lastSeq = snapshot.seq;
+            for (const auto& held : subscription->heldDeltas) {
+                if (held.first > subscription->lastSeq) {
+                    queueFrame(client, held.second);
+                    subscription->lastSeq = held.first;
+                }
+            }
+            subscription->heldDeltas.clear();
+            subscription->sync = BookSync::Live;
+            client.snapshotsSent.fetch_add(1, std::memory_order_relaxed);
+            snapshotsSent.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Server thread, every policy.flushIntervalMs: drops clients that have
+    // stayed behind too long, and resyncs those that have caught up
+    void flushSlowClients() {
+        std::vector<std::shared_ptr<ClientSession>> clients = allSessions();
+        Clock::time_point now = Clock::now();
+        for (const auto& client : clients) {
+            const char* disconnectReason = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(client->mailboxMutex);
+                if (client->closed) {
+                    continue;
+                }
+                size_t buffered = sampleBuffered(*client);
+                if (!client->conflating && !client->evict) {
+                    continue;
+                }
+                int64_t lagMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                    now - client->conflatingSince).count();
+                if (lagMicros > client->maxLagMicros.load(std::memory_order_relaxed)) {
+                    client->maxLagMicros.store(lagMicros, std::memory_order_relaxed);
+                }
+
+                if (client->evict) {
+                    disconnectReason = "slow consumer: trade backlog";
+                } else if (policy.disconnectAboveBytes && buffered > policy.disconnectAboveBytes) {
+                    disconnectReason = "slow consumer: send buffer full";
+                } else if (policy.disconnectAfterLagMs &&
+                           lagMicros > static_cast<int64_t>(policy.disconnectAfterLagMs) * 1000) {
+                    disconnectReason = "slow consumer: lagging";
+                }
+                if (disconnectReason) {
+                    client->closed = true;
+                    client->pendingTrades.clear();
+                }
+            }
+            if (disconnectReason) {
+                slowDisconnects.fetch_add(1, std::memory_order_relaxed);
+                websocketpp::lib::error_code ec;
+                client->connection->close(websocketpp::close::status::policy_violation, disconnectReason, ec);
+            }
+        }
+        resync(clients);
+    }
+
+    void scheduleFlush() {
+        endpoint.set_timer(policy.flushIntervalMs, [this](const websocketpp::lib::error_code& ec) {
+            if (ec || !running.load(std::memory_order_relaxed)) {
+                return;
+            }
+            flushSlowClients();
+            scheduleFlush();
+        });
+    }
+
+    // Publishing thread: hands one shared frame per format to every
+    // subscriber of 'instrument'. 'renderJson()' and
+    // 'renderBinary(instrumentId)' each run at most once, only if some
+    // subscriber wants that format, and 'deliver(subscription, frame)'
+    // decides per client what to do with it.
+    template <typename RenderJson, typename RenderBinary, typename Deliver>
+    void broadcast(const std::string& instrument, RenderJson&& renderJson, RenderBinary&& renderBinary,
+                   Deliver&& deliver) {
+        if (!running.load(std::memory_order_relaxed)) {
+            return;
+        }
+        subscriberTable.read([&](const SubscriberTable& table) {
+            auto it = table.find(instrument);
+            if (it == table.end() || it->second.empty()) {
+                return;
+            }
+            message_ptr json;
+            message_ptr binary;
+            for (const std::shared_ptr<Subscription>& subscription : it->second) {
+                ClientSession& client = *subscription->client;
+                message_ptr* frame = &json;
+                if (client.binary.load(std::memory_order_relaxed)) {
+                    frame = &binary;
+                    if (!binary) {
+                        binary = prepareFrame(renderBinary(subscription->instrumentId),
+                                              websocketpp::frame::opcode::binary);
+                    }
+                } else if (!json) {
+                    json = prepareFrame(renderJson());
+                }
+                std::lock_guard<std::mutex> lock(client.mailboxMutex);
+                if (!client.closed) {
+                    deliver(*subscription, *frame);
+                }
+            }
+            messagesPublished.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    static nlohmann::json renderLevels(const LevelUpdate* levels, size_t count) {
+        nlohmann::json out = nlohmann::json::array();
+        for (size_t i = 0; i < count; ++i) {
+            double amount = levels[i].action == LevelAction::Delete ? 0.0 : levels[i].amount;
+            out.push_back({fromFixedPrice(levels[i].price), amount});
+        }
+        return out;
+    }
+
+public:
+    explicit MarketDataServer(uint16_t listenPort, SlowConsumerPolicy slowConsumerPolicy = SlowConsumerPolicy())
+        : port(listenPort), policy(slowConsumerPolicy) {
+        endpoint.clear_access_channels(websocketpp::log::alevel::all);
+        endpoint.clear_error_channels(websocketpp::log::elevel::all);
+        endpoint.init_asio();
+        endpoint.set_reuse_addr(true);
+
+        endpoint.set_open_handler([this](websocketpp::connection_hdl hdl) {
+            handleOpen(hdl);
+        });
+        endpoint.set_message_handler([this](websocketpp::connection_hdl hdl, message_ptr msg) {
+            handleRequest(hdl, msg->get_payload());
+        });
+        endpoint.set_close_handler([this](websocketpp::connection_hdl hdl) {
+            handleClose(hdl);
+        });
+        endpoint.set_fail_handler([this](websocketpp::connection_hdl hdl) {
+            handleClose(hdl);
+        });
+    }
+
+    MarketDataServer(const MarketDataServer&) = delete;
+    MarketDataServer& operator=(const MarketDataServer&) = delete;
+
+    ~MarketDataServer() {
+        stop();
+        for (const auto& client : allSessions()) {
+            client->subscriptions.clear();
+        }
+    }
+
+    void setFirstSubscriberHandler(FirstSubscriberHandler handler) {
+        onFirstSubscriber = std::move(handler);
+    }
+
+    // Where snapshots for new and recovering subscribers come from;
+    // without it they wait for the exchange's next snapshot. Set before
+    // start().
+    void setBookSource(BookSource source) {
+        bookSource = std::move(source);
+    }
+
+    bool start() {
+        if (running) {
+            return true;
+        }
+        try {
+            endpoint.listen("127.0.0.1", std::to_string(port));
+            endpoint.start_accept();
+        } catch (const std::exception& e) {
+            std::cerr << "Market data server: cannot listen on 127.0.0.1:" << port << ": " << e.what() << std::endl;
+            return false;
+        }
+        running = true;
+        scheduleFlush();
+        serverThread = std::thread([this]() {
+            try {
+                endpoint.run();
+            } catch (const std::exception& e) {
+                std::cerr << "Market data server error: " << e.what() << std::endl;
+            }
+        });
+        std::cout << "Market data fan-out at ws://127.0.0.1:" << port << std::endl;
+        return true;
+    }
+
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+        websocketpp::lib::error_code ec;
+        endpoint.stop_listening(ec);
+        endpoint.stop();
+        if (serverThread.joinable()) {
+            serverThread.join();
+        }
+    }
+
+    // Normalized book update (delta, or a full book if view.isSnapshot)
+    // that took the in-process book to update number 'seq'
+    // (OrderBook::getUpdateCount() right after applying it)
+    void publishBook(const std::string& instrument, const BookUpdateView& view, uint64_t seq) {
+        broadcast(instrument, [&]() {
+            return nlohmann::json{
+                {"type", "book"},
+                {"instrument", instrument},
+                {"seq", seq},
+                {"timestamp", view.timestamp},
+                {"change_id", view.changeId},
+                {"snapshot", view.isSnapshot},
+                {"bids", renderLevels(view.bids, view.bidCount)},
+                {"asks", renderLevels(view.asks, view.askCount)}
+            }.dump();
+        }, [&](uint32_t instrumentId) {
+            std::string payload;
+            appendWire(payload, wireBookSize(view.bidCount + view.askCount), [&](uint8_t* out, size_t capacity) {
+                return encodeWireBook(out, capacity, instrumentId, view.isSnapshot, seq, view.timestamp,
+                                      view.changeId, view.bids, view.bidCount, view.asks, view.askCount);
+            });
+            return payload;
+        }, [&](Subscription& subscription, const message_ptr& frame) {
+            deliverBook(subscription, frame, seq, view.isSnapshot);
+        });
+    }
+
+    // Sends every subscriber the whole of 'book', e.g. after it was
+    // rebuilt from a resync rather than by a single update
+    void publishBookSnapshot(const std::string& instrument, const OrderBook& book) {
+        // Read once, whichever format renders first
+        bool taken = false;
+        auto take = [&]() -> const OrderBook::Snapshot& {
+            if (!taken) {
+                book.snapshot(*publishSnapshot);
+                taken = true;
+            }
+            return *publishSnapshot;
+        };
+        uint64_t seq = 0;
+        broadcast(instrument, [&]() {
+            seq = take().updateCount;
+            return renderSnapshot(instrument, *publishSnapshot);
+        }, [&](uint32_t instrumentId) {
+            seq = take().updateCount;
+            return renderBinarySnapshot(instrumentId, *publishSnapshot);
+        }, [&](Subscription& subscription, const message_ptr& frame) {
+            deliverBook(subscription, frame, seq, true);
+        });
+    }
+
+    void publishTrades(const std::string& instrument, const TradesNotification& update) {
+        broadcast(instrument, [&]() {
+            nlohmann::json trades = nlohmann::json::array();
+            for (uint32_t i = 0; i < update.count; ++i) {
+                const TradeEntry& trade = update.trades[i];
+                trades.push_back({
+                    {"trade_id", std::string(trade.tradeId)},
+                    {"price", fromFixedPrice(trade.price)},
+                    {"amount", trade.amount},
+                    {"direction", trade.direction == TradeDirection::Buy ? "buy" : "sell"},
+                    {"timestamp", trade.timestamp}
+                });
+            }
+            return nlohmann::json{{"type", "trades"}, {"instrument", instrument}, {"trades", trades}}.dump();
+        }, [&](uint32_t instrumentId) {
+            std::string payload;
+            payload.reserve(update.count * sizeof(WireTrade));
+            for (uint32_t i = 0; i < update.count; ++i) {
+                const TradeEntry& trade = update.trades[i];
+                appendWire(payload, sizeof(WireTrade), [&](uint8_t* out, size_t capacity) {
+                    return encodeWireTrade(out, capacity, instrumentId, trade.tradeId, trade.price, trade.amount,
+                                           static_cast<uint8_t>(trade.direction), trade.timestamp, trade.tradeSeq);
+                });
+            }
+            return payload;
+        }, [&](Subscription& subscription, const message_ptr& frame) {
+            ClientSession& client = *subscription.client;
+            if (!checkBackedUp(client)) {
+                queueFrame(client, frame);
+                return;
+            }
+            if (client.pendingTrades.size() >= policy.maxPendingTrades) {
+                if (policy.disconnectOnTradeOverflow) {
+                    client.evict = true;
+                    return;
+                }
+                client.pendingTrades.pop_front();
+                client.droppedTrades.fetch_add(1, std::memory_order_relaxed);
+                droppedTrades.fetch_add(1, std::memory_order_relaxed);
+            }
+            client.pendingTrades.push_back(frame);
+        });
+    }
+
+    // Any thread
+    std::vector<FanoutClientStats> clientStats() const {
+        Clock::time_point now = Clock::now();
+        std::vector<FanoutClientStats> result;
+        for (const auto& client : allSessions()) {
+            FanoutClientStats stats;
+            stats.remote = client->remote;
+            stats.subscriptions = client->subscriptionCount.load(std::memory_order_relaxed);
+            stats.bufferedBytes = client->bufferedBytes.load(std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(client->mailboxMutex);
+                stats.conflating = client->conflating;
+                if (client->conflating) {
+                    stats.lagMs = std::chrono::duration<double, std::milli>(now - client->conflatingSince).count();
+                }
+            }
+            stats.maxLagMs = std::max(stats.lagMs, client->maxLagMicros.load(std::memory_order_relaxed) / 1000.0);
+            stats.framesSent = client->framesSent.load(std::memory_order_relaxed);
+            stats.conflatedUpdates = client->conflatedUpdates.load(std::memory_order_relaxed);
+            stats.snapshotsSent = client->snapshotsSent.load(std::memory_order_relaxed);
+            stats.droppedTrades = client->droppedTrades.load(std::memory_order_relaxed);
+            result.push_back(std::move(stats));
+        }
+        return result;
+    }
+
+    // Aggregates, plus lag and buffer gauges for the clients that are
+    // behind (a series per client would not scale to thousands of them)
+    std::string exportPrometheus() const {
+        std::vector<FanoutClientStats> clients = clientStats();
+        std::string out;
+        auto counter = [&](const char* name, const char* help, const std::atomic<uint64_t>& value) {
+            appendFormat(out, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+            appendFormat(out, "%s %llu\n", name, static_cast<unsigned long long>(value.load(std::memory_order_relaxed)));
+        };
+        size_t lagging = 0;
+        for (const FanoutClientStats& client : clients) {
+            lagging += client.conflating ? 1 : 0;
+        }
+
+        out += "# HELP deribit_fanout_clients Connected downstream clients.\n";
+        out += "# TYPE deribit_fanout_clients gauge\n";
+        appendFormat(out, "deribit_fanout_clients %zu\n", clients.size());
+        out += "# HELP deribit_fanout_conflating_clients Downstream clients currently behind and conflated.\n";
+        out += "# TYPE deribit_fanout_conflating_clients gauge\n";
+        appendFormat(out, "deribit_fanout_conflating_clients %zu\n", lagging);
+        counter("deribit_fanout_messages_total", "Updates serialized for downstream clients.", messagesPublished);
+        counter("deribit_fanout_frames_total", "Frames queued across all downstream clients.", framesQueued);
+        counter("deribit_fanout_conflated_updates_total", "Book updates folded into a later snapshot.", conflatedUpdates);
+        counter("deribit_fanout_snapshots_total", "Snapshots sent to clients that joined or caught up.", snapshotsSent);
+        counter("deribit_fanout_dropped_trades_total", "Trade batches dropped for slow clients.", droppedTrades);
+        counter("deribit_fanout_slow_disconnects_total", "Clients closed by the slow consumer policy.", slowDisconnects);
+
+        out += "# HELP deribit_fanout_client_lag_seconds How long a conflating client's state has been waiting.\n";
+        out += "# TYPE deribit_fanout_client_lag_seconds gauge\n";
+        for (const FanoutClientStats& client : clients) {
+            if (client.conflating) {
+                appendFormat(out, "deribit_fanout_client_lag_seconds{client=\"%s\"} %.6f\n", client.remote.c_str(), client.lagMs / 1000.0);
+            }
+        }
+        out += "# HELP deribit_fanout_client_buffered_bytes Bytes waiting in a conflating client's send buffer.\n";
+        out += "# TYPE deribit_fanout_client_buffered_bytes gauge\n";
+        for (const FanoutClientStats& client : clients) {
+            if (client.conflating) {
+                appendFormat(out, "deribit_fanout_client_buffered_bytes{client=\"%s\"} %zu\n", client.remote.c_str(), client.bufferedBytes);
+            }
+        }
+        return out;
+    }
+
+    void printClientStats() const {
+        std::vector<FanoutClientStats> clients = clientStats();
+        std::cout << "\n=== Market Data Fan-out ===" << std::endl;
+        std::cout << "Clients: " << clients.size() << ", updates serialized: " << publishedCount()
+                  << ", frames queued: " << queuedFrameCount()
+                  << ", slow disconnects: " << slowDisconnects.load(std::memory_order_relaxed) << std::endl;
+        for (const FanoutClientStats& client : clients) {
+            std::cout << "  " << client.remote << ": " << client.subscriptions << " instruments, "
+                      << client.framesSent << " frames, " << client.bufferedBytes << " bytes buffered"
+                      << (client.conflating ? ", CONFLATING" : "")
+                      << ", lag " << client.lagMs << " ms (max " << client.maxLagMs << " ms)"
+                      << ", conflated " << client.conflatedUpdates
+                      << ", snapshots " << client.snapshotsSent
+                      << ", dropped trades " << client.droppedTrades << std::endl;
+        }
+    }
+
+    // Updates serialized, and frames queued across all subscribers
+    uint64_t publishedCount() const { return messagesPublished.load(std::memory_order_relaxed); }
+    uint64_t queuedFrameCount() const { return framesQueued.load(std::memory_order_relaxed); }
+};
+
+#endif // MARKET_DATA_SERVER_H
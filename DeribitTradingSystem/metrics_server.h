@@ -0,0 +1,178 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "performance_monitor.h"
+
+// --------------------------------------------------------------------
+// MetricsServer: minimal HTTP/1.1 endpoint for scraping PerformanceMonitor
+//   - Listens on 127.0.0.1 only. GET /metrics returns the Prometheus text
+//     format; anything else is a 404. One connection at a time, closed
+//     after each response.
+//   - Rendering reads the monitor's aggregated snapshot, so scrapes never
+//     touch the recording path, however often they come.
+// --------------------------------------------------------------------
+class MetricsServer {
+private:
+    PerformanceMonitor& monitor;
+    uint16_t port;
+    int listenFd = -1;
+    std::atomic<bool> running{false};
+    std::thread serverThread;
+    // Extra exposition text appended to each scrape (see addSource)
+    std::vector<std::function<std::string()>> sources;
+
+    static constexpr size_t kMaxRequestBytes = 8192;
+
+    static void sendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    static std::string response(const char* status, const char* contentType, const std::string& body) {
+        std::string out = std::string("HTTP/1.1 ") + status + "\r\n";
+        out += std::string("Content-Type: ") + contentType + "\r\n";
+        out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        out += "Connection: close\r\n\r\n";
+        out += body;
+        return out;
+    }
+
+    void handleConnection(int fd) {
+        // A slow or idle client must not hold up the next scrape for long
+        timeval timeout{1, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes) {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                return;
+            }
+            request.append(buffer, static_cast<size_t>(n));
+        }
+
+        // Request line: METHOD SP PATH SP VERSION
+        size_t methodEnd = request.find(' ');
+        size_t pathEnd = methodEnd == std::string::npos ? std::string::npos : request.find(' ', methodEnd + 1);
+        if (pathEnd == std::string::npos) {
+            sendAll(fd, response("400 Bad Request", "text/plain", "Bad request\n"));
+            return;
+        }
+        std::string method = request.substr(0, methodEnd);
+        std::string path = request.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+
+        if (method != "GET") {
+            sendAll(fd, response("405 Method Not Allowed", "text/plain", "Only GET is supported\n"));
+        } else if (path == "/metrics") {
+            std::string body = monitor.exportPrometheus();
+            for (const auto& source : sources) {
+                body += source();
+            }
+            sendAll(fd, response("200 OK", "text/plain; version=0.0.4; charset=utf-8", body));
+        } else {
+            sendAll(fd, response("404 Not Found", "text/plain", "Try /metrics\n"));
+        }
+    }
+
+    void run() {
+        while (running) {
+            pollfd pfd{listenFd, POLLIN, 0};
+            // Wake up periodically to notice stop()
+            if (::poll(&pfd, 1, 200) <= 0) {
+                continue;
+            }
+            int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                continue;
+            }
+            try {
+                handleConnection(fd);
+            } catch (const std::exception& e) {
+                std::cerr << "Error serving metrics: " << e.what() << std::endl;
+            }
+            ::close(fd);
+        }
+    }
+
+public:
+    MetricsServer(PerformanceMonitor& pm, uint16_t listenPort) : monitor(pm), port(listenPort) {}
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    ~MetricsServer() {
+        stop();
+    }
+
+    // Adds metrics from outside the monitor. Call before start(); 'source'
+    // runs on the server thread for every scrape.
+    void addSource(std::function<std::string()> source) {
+        sources.push_back(std::move(source));
+    }
+
+    bool start() {
+        if (running) {
+            return true;
+        }
+
+        listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            std::cerr << "Metrics server: socket() failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+            ::listen(listenFd, 16) < 0) {
+            std::cerr << "Metrics server: cannot listen on 127.0.0.1:" << port << ": "
+                      << std::strerror(errno) << std::endl;
+            ::close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+
+        running = true;
+        serverThread = std::thread([this]() { run(); });
+        std::cout << "Metrics available at http://127.0.0.1:" << port << "/metrics" << std::endl;
+        return true;
+    }
+
+    void stop() {
+        running = false;
+        if (serverThread.joinable()) {
+            serverThread.join();
+        }
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            listenFd = -1;
+        }
+    }
+};
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,1101 @@
+// --------------------------------------------------------------------
+// Mock Deribit exchange for offline, reproducible benchmarks
+//   Serves the part of the v2 JSON-RPC API the client uses, over REST
+//   (HTTP/1.1 keep-alive, POST to any path) and WebSocket (ws://):
+//     public/auth, public/get_time, public/get_order_book,
+//     public/get_instruments, private/get_positions, private/buy,
+//     private/sell, private/edit, private/cancel and
+//     public|private/subscribe, public|private/unsubscribe (WebSocket)
+//   It streams synthetic book.<instrument>.{raw,100ms} deltas and
+//   trades.<instrument>.{raw,100ms} at configurable rates, plus
+//   user.orders / user.trades events for orders placed through it.
+//
+//   Build:  g++ -std=c++17 -O2 mock_exchange.cpp -o mock_exchange -pthread
+//   Run:    ./mock_exchange [--rest-port 8080] [--ws-port 8081]
+//                           [--book-rate 100] [--trade-rate 10]
+//                           [--depth 10] [--seed 1]
+//                           [--instruments BTC-PERPETUAL,ETH-PERPETUAL]
+//   Rates are messages per second per instrument (0 disables a stream).
+//   Then point the client at it:
+//     DERIBIT_REST_URL=http://127.0.0.1:8080/api/v2
+//     DERIBIT_WS_URL=ws://127.0.0.1:8081/ws/api/v2
+//
+//   Any credentials are accepted. Orders that cross the synthetic book
+//   fill in full at the touch; others rest until edited or cancelled.
+//   The book is a seeded random walk, so runs with the same options
+//   produce the same sequence of prices.
+// --------------------------------------------------------------------
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+#include <nlohmann/json.hpp>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using server = websocketpp::server<websocketpp::config::asio>;
+
+static const char* kAccessToken = "mock-access-token";
+
+struct MockOptions {
+    uint16_t restPort = 8080;
+    uint16_t wsPort = 8081;
+    double bookRate = 100.0;   // book deltas per second per instrument
+    double tradeRate = 10.0;   // trades per second per instrument
+    int depth = 10;            // levels per side
+    uint64_t seed = 1;
+    std::vector<std::string> instruments = {"BTC-PERPETUAL", "ETH-PERPETUAL"};
+};
+
+static std::atomic<bool> g_running{true};
+
+static int64_t nowMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static int64_t nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+// Deribit-style error codes used below
+struct RpcError {
+    int code;
+    std::string message;
+};
+
+// --------------------------------------------------------------------
+// SyntheticBook: L2 book around a random-walk mid price. Prices are kept
+// in integer ticks so every level prints exactly.
+// --------------------------------------------------------------------
+struct SyntheticBook {
+    std::string instrument;
+    std::string currency;
+    int64_t ticksPerUnit = 100;     // 1 / tick size
+    int64_t midTicks = 0;
+    std::map<int64_t, double> bids; // ticks -> amount
+    std::map<int64_t, double> asks;
+    int64_t changeId = 0;
+    int64_t tradeSeq = 0;
+    int64_t lastTradeTicks = 0;
+
+    double price(int64_t ticks) const {
+        return static_cast<double>(ticks) / static_cast<double>(ticksPerUnit);
+    }
+
+    int64_t toTicks(double value) const {
+        return static_cast<int64_t>(std::llround(value * static_cast<double>(ticksPerUnit)));
+    }
+
+    int64_t bestBid() const { return bids.empty() ? 0 : bids.rbegin()->first; }
+    int64_t bestAsk() const { return asks.empty() ? 0 : asks.begin()->first; }
+
+    json levels(bool bidSide, int depth, bool withAction) const {
+        json out = json::array();
+        auto emit = [&](int64_t ticks, double amount) {
+            if (withAction) {
+                out.push_back({"new", price(ticks), amount});
+            } else {
+                out.push_back({price(ticks), amount});
+            }
+        };
+        int n = 0;
+        if (bidSide) {
+            for (auto it = bids.rbegin(); it != bids.rend() && n < depth; ++it, ++n) {
+                emit(it->first, it->second);
+            }
+        } else {
+            for (auto it = asks.begin(); it != asks.end() && n < depth; ++it, ++n) {
+                emit(it->first, it->second);
+            }
+        }
+        return out;
+    }
+};
+
+// --------------------------------------------------------------------
+// MockExchange: instruments, orders, positions, WebSocket sessions.
+// One mutex covers all of it, so a subscriber's snapshot and the deltas
+// that follow it are always consistent.
+// --------------------------------------------------------------------
+class MockExchange {
+private:
+    struct Session {
+        bool authorized = false;
+        std::set<std::string> channels;
+    };
+
+    struct Position {
+        double size = 0.0;      // signed
+        double averagePrice = 0.0;
+    };
+
+    MockOptions options;
+    std::mutex stateMutex;
+    std::mt19937_64 rng;
+    std::map<std::string, SyntheticBook> books;
+    std::map<std::string, json> orders; // order_id -> order
+    std::map<std::string, Position> positions;
+    uint64_t nextOrderId = 1;
+    uint64_t nextTradeId = 1;
+
+    server* wsServer = nullptr;
+    std::map<websocketpp::connection_hdl, Session, std::owner_less<websocketpp::connection_hdl>> sessions;
+
+    // Filled by subscribe(), sent once the subscription reply is out
+    struct PendingSnapshot {
+        websocketpp::connection_hdl hdl;
+        std::string channel;
+        json data;
+    };
+    std::vector<PendingSnapshot> pendingSnapshots;
+
+    double randomAmount() {
+        return static_cast<double>(std::uniform_int_distribution<int>(1, 100)(rng) * 10);
+    }
+
+    // Caller holds stateMutex. Serializes the notification once and sends
+    // it to every session subscribed to 'channel'.
+    void publish(const std::string& channel, const json& data) {
+        std::string message;
+        for (auto& entry : sessions) {
+            if (entry.second.channels.count(channel) == 0) {
+                continue;
+            }
+            if (message.empty()) {
+                message = json{
+                    {"jsonrpc", "2.0"},
+                    {"method", "subscription"},
+                    {"params", {{"channel", channel}, {"data", data}}}
+                }.dump();
+            }
+            websocketpp::lib::error_code ec;
+            wsServer->send(entry.first, message, websocketpp::frame::opcode::text, ec);
+        }
+    }
+
+    // user.<kind>.<instrument>.<interval> or user.<kind>.<kind>.<currency>.<interval>
+    static bool userChannelMatches(const std::string& channel, const std::string& kind,
+                                   const SyntheticBook& book) {
+        std::vector<std::string> parts = split(channel, '.');
+        if (parts.size() < 4 || parts[0] != "user" || parts[1] != kind) {
+            return false;
+        }
+        if (parts.size() == 4) {
+            return parts[2] == book.instrument;
+        }
+        return parts.size() == 5 && (parts[2] == "any" || parts[2] == "future") &&
+               (parts[3] == "any" || parts[3] == book.currency);
+    }
+
+    // Caller holds stateMutex
+    void publishUser(const std::string& kind, const SyntheticBook& book, const json& data) {
+        std::set<std::string> matching;
+        for (const auto& entry : sessions) {
+            if (!entry.second.authorized) {
+                continue;
+            }
+            for (const std::string& channel : entry.second.channels) {
+                if (userChannelMatches(channel, kind, book)) {
+                    matching.insert(channel);
+                }
+            }
+        }
+        for (const std::string& channel : matching) {
+            publish(channel, data);
+        }
+    }
+
+    // Caller holds stateMutex. Sets 'depth' contiguous levels on each
+    // side of the mid, recording the differences as book changes.
+    void reshape(SyntheticBook& book, json& bidChanges, json& askChanges) {
+        auto reshapeSide = [&](std::map<int64_t, double>& side, int64_t lowest, json& changes) {
+            int64_t highest = lowest + options.depth - 1;
+            for (auto it = side.begin(); it != side.end();) {
+                if (it->first < lowest || it->first > highest) {
+                    changes.push_back({"delete", book.price(it->first), 0.0});
+                    it = side.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            for (int64_t ticks = lowest; ticks <= highest; ++ticks) {
+                if (side.count(ticks) == 0) {
+                    double amount = randomAmount();
+                    side[ticks] = amount;
+                    changes.push_back({"new", book.price(ticks), amount});
+                }
+            }
+        };
+        reshapeSide(book.bids, book.midTicks - options.depth, bidChanges);
+        reshapeSide(book.asks, book.midTicks + 1, askChanges);
+    }
+
+    json snapshotData(const SyntheticBook& book) const {
+        return {
+            {"type", "snapshot"},
+            {"timestamp", nowMillis()},
+            {"change_id", book.changeId},
+            {"instrument_name", book.instrument},
+            {"bids", book.levels(true, options.depth, true)},
+            {"asks", book.levels(false, options.depth, true)}
+        };
+    }
+
+    // Caller holds stateMutex. Fills 'order' in full at 'ticks' and
+    // reports the trade publicly and to the owner.
+    json fill(json& order, SyntheticBook& book, int64_t ticks) {
+        double amount = order["amount"].get<double>();
+        bool buy = order["direction"] == "buy";
+        int64_t timestamp = nowMillis();
+
+        order["filled_amount"] = amount;
+        order["average_price"] = book.price(ticks);
+        order["order_state"] = "filled";
+        order["last_update_timestamp"] = timestamp;
+
+        Position& position = positions[book.instrument];
+        double signedAmount = buy ? amount : -amount;
+        if ((position.size >= 0) == (signedAmount >= 0)) {
+            double total = std::abs(position.size) + amount;
+            position.averagePrice = (position.averagePrice * std::abs(position.size) + book.price(ticks) * amount) / total;
+        } else if (std::abs(signedAmount) > std::abs(position.size)) {
+            position.averagePrice = book.price(ticks);
+        }
+        position.size += signedAmount;
+
+        json trade = {
+            {"trade_seq", ++book.tradeSeq},
+            {"trade_id", "MOCK-" + std::to_string(nextTradeId++)},
+            {"timestamp", timestamp},
+            {"tick_direction", ticks >= book.lastTradeTicks ? 0 : 2},
+            {"price", book.price(ticks)},
+            {"mark_price", book.price(book.midTicks)},
+            {"index_price", book.price(book.midTicks)},
+            {"instrument_name", book.instrument},
+            {"direction", buy ? "buy" : "sell"},
+            {"amount", amount}
+        };
+        book.lastTradeTicks = ticks;
+        publish("trades." + book.instrument + ".raw", json::array({trade}));
+        publish("trades." + book.instrument + ".100ms", json::array({trade}));
+
+        json userTrade = trade;
+        userTrade["order_id"] = order["order_id"];
+        userTrade["order_type"] = order["order_type"];
+        userTrade["state"] = "filled";
+        userTrade["label"] = order["label"];
+        publishUser("trades", book, json::array({userTrade}));
+        return json::array({userTrade});
+    }
+
+    // Caller holds stateMutex
+    SyntheticBook& bookFor(const json& params) {
+        if (!params.contains("instrument_name") || !params["instrument_name"].is_string()) {
+            throw RpcError{-32602, "Invalid params: instrument_name is required"};
+        }
+        auto it = books.find(params["instrument_name"].get<std::string>());
+        if (it == books.end()) {
+            throw RpcError{13020, "not_found"};
+        }
+        return it->second;
+    }
+
+    static double numberParam(const json& params, const char* name) {
+        if (!params.contains(name) || !params[name].is_number()) {
+            throw RpcError{-32602, std::string("Invalid params: ") + name + " must be a number"};
+        }
+        double value = params[name].get<double>();
+        if (!(value > 0.0)) {
+            throw RpcError{-32602, std::string("Invalid params: ") + name + " must be positive"};
+        }
+        return value;
+    }
+
+    // Caller holds stateMutex
+    json placeOrder(bool buy, const json& params) {
+        SyntheticBook& book = bookFor(params);
+        double amount = numberParam(params, "amount");
+        std::string type = params.value("type", "limit");
+        if (type != "limit" && type != "market") {
+            throw RpcError{-32602, "Invalid params: unsupported order type " + type};
+        }
+
+        int64_t touch = buy ? book.bestAsk() : book.bestBid();
+        int64_t limitTicks = type == "market" ? touch : book.toTicks(numberParam(params, "price"));
+        int64_t timestamp = nowMillis();
+        std::string orderId = "MOCK-ORD-" + std::to_string(nextOrderId++);
+        json order = {
+            {"order_id", orderId},
+            {"instrument_name", book.instrument},
+            {"direction", buy ? "buy" : "sell"},
+            {"order_type", type},
+            {"price", type == "market" ? json("market_price") : json(book.price(limitTicks))},
+            {"amount", amount},
+            {"filled_amount", 0.0},
+            {"average_price", 0.0},
+            {"order_state", "open"},
+            {"time_in_force", params.value("time_in_force", "good_til_cancelled")},
+            {"label", params.value("label", "")},
+            {"post_only", params.value("post_only", false)},
+            {"creation_timestamp", timestamp},
+            {"last_update_timestamp", timestamp},
+            {"api", true}
+        };
+
+        json trades = json::array();
+        bool crosses = touch != 0 && (buy ? limitTicks >= touch : limitTicks <= touch);
+        if (crosses) {
+            trades = fill(order, book, touch);
+        }
+        orders[orderId] = order;
+        publishUser("orders", book, order);
+        return {{"order", order}, {"trades", trades}};
+    }
+
+    // Caller holds stateMutex
+    json& openOrder(const json& params) {
+        if (!params.contains("order_id") || !params["order_id"].is_string()) {
+            throw RpcError{-32602, "Invalid params: order_id is required"};
+        }
+        auto it = orders.find(params["order_id"].get<std::string>());
+        if (it == orders.end()) {
+            throw RpcError{11044, "not_open_order"};
+        }
+        if (it->second["order_state"] != "open") {
+            throw RpcError{11044, "not_open_order"};
+        }
+        return it->second;
+    }
+
+    // Caller holds stateMutex
+    json editOrder(const json& params) {
+        json& order = openOrder(params);
+        SyntheticBook& book = books.at(order["instrument_name"].get<std::string>());
+        double amount = numberParam(params, "amount");
+        int64_t limitTicks = book.toTicks(numberParam(params, "price"));
+        order["amount"] = amount;
+        order["price"] = book.price(limitTicks);
+        order["last_update_timestamp"] = nowMillis();
+
+        bool buy = order["direction"] == "buy";
+        int64_t touch = buy ? book.bestAsk() : book.bestBid();
+        json trades = json::array();
+        if (touch != 0 && (buy ? limitTicks >= touch : limitTicks <= touch)) {
+            trades = fill(order, book, touch);
+        }
+        publishUser("orders", book, order);
+        return {{"order", order}, {"trades", trades}};
+    }
+
+    // Caller holds stateMutex
+    json cancelOrder(const json& params) {
+        json& order = openOrder(params);
+        SyntheticBook& book = books.at(order["instrument_name"].get<std::string>());
+        order["order_state"] = "cancelled";
+        order["last_update_timestamp"] = nowMillis();
+        publishUser("orders", book, order);
+        return order;
+    }
+
+    // Caller holds stateMutex
+    json orderBook(const json& params) {
+        SyntheticBook& book = bookFor(params);
+        int depth = params.contains("depth") && params["depth"].is_number_integer()
+            ? std::max(1, params["depth"].get<int>()) : options.depth;
+        json result = {
+            {"instrument_name", book.instrument},
+            {"timestamp", nowMillis()},
+            {"change_id", book.changeId},
+            {"state", "open"},
+            {"bids", book.levels(true, depth, false)},
+            {"asks", book.levels(false, depth, false)},
+            {"mark_price", book.price(book.midTicks)},
+            {"index_price", book.price(book.midTicks)},
+            {"last_price", book.lastTradeTicks ? json(book.price(book.lastTradeTicks)) : json(nullptr)}
+        };
+        if (!book.bids.empty()) {
+            result["best_bid_price"] = book.price(book.bestBid());
+            result["best_bid_amount"] = book.bids.rbegin()->second;
+        }
+        if (!book.asks.empty()) {
+            result["best_ask_price"] = book.price(book.bestAsk());
+            result["best_ask_amount"] = book.asks.begin()->second;
+        }
+        return result;
+    }
+
+    // Caller holds stateMutex
+    json instrumentList(const json& params) {
+        std::string currency = params.value("currency", "any");
+        std::string kind = params.value("kind", "future");
+        json result = json::array();
+        if (kind != "future" && kind != "any") {
+            return result;
+        }
+        for (const auto& entry : books) {
+            const SyntheticBook& book = entry.second;
+            if (currency != "any" && currency != book.currency) {
+                continue;
+            }
+            result.push_back({
+                {"instrument_name", book.instrument},
+                {"kind", "future"},
+                {"base_currency", book.currency},
+                {"quote_currency", "USD"},
+                {"settlement_period", "perpetual"},
+                {"tick_size", 1.0 / static_cast<double>(book.ticksPerUnit)},
+                {"min_trade_amount", 10},
+                {"contract_size", 10},
+                {"is_active", true},
+                {"creation_timestamp", 0},
+                {"expiration_timestamp", 32503708800000LL}
+            });
+        }
+        return result;
+    }
+
+    // Caller holds stateMutex
+    json positionList(const json& params) {
+        std::string currency = params.value("currency", "any");
+        json result = json::array();
+        for (const auto& entry : books) {
+            const SyntheticBook& book = entry.second;
+            if (currency != "any" && currency != book.currency) {
+                continue;
+            }
+            Position position;
+            auto it = positions.find(book.instrument);
+            if (it != positions.end()) {
+                position = it->second;
+            }
+            double mark = book.price(book.midTicks);
+            result.push_back({
+                {"instrument_name", book.instrument},
+                {"kind", "future"},
+                {"size", position.size},
+                {"direction", position.size > 0 ? "buy" : position.size < 0 ? "sell" : "zero"},
+                {"average_price", position.averagePrice},
+                {"mark_price", mark},
+                {"index_price", mark},
+                {"floating_profit_loss", position.size * (mark - position.averagePrice) / (mark > 0 ? mark : 1.0)}
+            });
+        }
+        return result;
+    }
+
+    // Caller holds stateMutex
+    json subscribe(Session& session, const websocketpp::connection_hdl& hdl, const json& params,
+                   bool isPrivate, bool add) {
+        if (!params.contains("channels") || !params["channels"].is_array()) {
+            throw RpcError{-32602, "Invalid params: channels must be an array"};
+        }
+        json result = json::array();
+        for (const json& value : params["channels"]) {
+            if (!value.is_string()) {
+                continue;
+            }
+            std::string channel = value.get<std::string>();
+            bool userChannel = channel.compare(0, 5, "user.") == 0;
+            if (userChannel && !(isPrivate && session.authorized)) {
+                continue; // private channels need private/subscribe on an authorized session
+            }
+            if (!add) {
+                session.channels.erase(channel);
+                result.push_back(channel);
+                continue;
+            }
+            std::vector<std::string> parts = split(channel, '.');
+            if (!userChannel && (parts.size() != 3 || (parts[0] != "book" && parts[0] != "trades") ||
+                                 books.count(parts[1]) == 0)) {
+                continue; // unknown channel
+            }
+            // New book subscribers get a snapshot right after the reply
+            if (session.channels.insert(channel).second && parts[0] == "book") {
+                pendingSnapshots.push_back({hdl, channel, snapshotData(books.at(parts[1]))});
+            }
+            result.push_back(channel);
+        }
+        return result;
+    }
+
+    static json response(const json& request, int64_t receivedAt, const json& result) {
+        int64_t sentAt = nowMicros();
+        return {
+            {"jsonrpc", "2.0"},
+            {"id", request.contains("id") ? request["id"] : json(nullptr)},
+            {"result", result},
+            {"usIn", receivedAt},
+            {"usOut", sentAt},
+            {"usDiff", sentAt - receivedAt},
+            {"testnet", true}
+        };
+    }
+
+    static json errorResponse(const json& request, const RpcError& error) {
+        return {
+            {"jsonrpc", "2.0"},
+            {"id", request.contains("id") ? request["id"] : json(nullptr)},
+            {"error", {{"code", error.code}, {"message", error.message}}},
+            {"testnet", true}
+        };
+    }
+
+    // Caller holds stateMutex. 'session' is null for REST requests.
+    json handle(const json& request, bool authorized, Session* session, const websocketpp::connection_hdl& hdl) {
+        int64_t receivedAt = nowMicros();
+        try {
+            if (!request.is_object() || !request.contains("method") || !request["method"].is_string()) {
+                throw RpcError{-32600, "Invalid Request"};
+            }
+            const std::string method = request["method"].get<std::string>();
+            const json params = request.contains("params") && request["params"].is_object()
+                ? request["params"] : json::object();
+            bool isPrivate = method.compare(0, 8, "private/") == 0;
+            if (isPrivate && !authorized) {
+                throw RpcError{13009, "unauthorized"};
+            }
+
+            if (method == "public/auth") {
+                if (session) {
+                    session->authorized = true;
+                }
+                return response(request, receivedAt, {
+                    {"access_token", kAccessToken},
+                    {"refresh_token", "mock-refresh-token"},
+                    {"expires_in", 31536000},
+                    {"token_type", "bearer"},
+                    {"scope", "connection mainaccount trade:read_write"}
+                });
+            }
+            if (method == "public/get_time") {
+                return response(request, receivedAt, nowMillis());
+            }
+            if (method == "public/test") {
+                return response(request, receivedAt, {{"version", "mock"}});
+            }
+            if (method == "public/get_order_book") {
+                return response(request, receivedAt, orderBook(params));
+            }
+            if (method == "public/get_instruments") {
+                return response(request, receivedAt, instrumentList(params));
+            }
+            if (method == "private/get_positions") {
+                return response(request, receivedAt, positionList(params));
+            }
+            if (method == "private/buy" || method == "private/sell") {
+                return response(request, receivedAt, placeOrder(method == "private/buy", params));
+            }
+            if (method == "private/edit") {
+                return response(request, receivedAt, editOrder(params));
+            }
+            if (method == "private/cancel") {
+                return response(request, receivedAt, cancelOrder(params));
+            }
+            if (method == "public/subscribe" || method == "private/subscribe" ||
+                method == "public/unsubscribe" || method == "private/unsubscribe") {
+                if (!session) {
+                    throw RpcError{-32601, "Subscriptions are only available over WebSocket"};
+                }
+                bool add = method.find("unsubscribe") == std::string::npos;
+                return response(request, receivedAt, subscribe(*session, hdl, params, isPrivate, add));
+            }
+            throw RpcError{-32601, "Method not found"};
+        } catch (const RpcError& error) {
+            return errorResponse(request, error);
+        } catch (const json::exception& e) {
+            return errorResponse(request, RpcError{-32602, std::string("Invalid params: ") + e.what()});
+        }
+    }
+
+public:
+    explicit MockExchange(const MockOptions& opts) : options(opts), rng(opts.seed) {
+        for (const std::string& instrument : options.instruments) {
+            SyntheticBook book;
+            book.instrument = instrument;
+            book.currency = instrument.substr(0, instrument.find('-'));
+            double startPrice = 100.0;
+            if (book.currency == "BTC") {
+                book.ticksPerUnit = 2;      // tick 0.5
+                startPrice = 60000.0;
+            } else if (book.currency == "ETH") {
+                book.ticksPerUnit = 20;     // tick 0.05
+                startPrice = 3000.0;
+            }
+            book.midTicks = book.toTicks(startPrice);
+            book.lastTradeTicks = book.midTicks;
+            book.changeId = 1;
+            json ignoredBids = json::array();
+            json ignoredAsks = json::array();
+            reshape(book, ignoredBids, ignoredAsks);
+            books[instrument] = book;
+        }
+    }
+
+    void setServer(server* s) {
+        wsServer = s;
+    }
+
+    // REST entry point: one JSON-RPC request body in, response body out
+    std::string handleRest(const std::string& body, bool authorized) {
+        json request;
+        try {
+            request = json::parse(body);
+        } catch (const json::exception&) {
+            return errorResponse(json::object(), RpcError{-32700, "Parse error"}).dump();
+        }
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return handle(request, authorized, nullptr, websocketpp::connection_hdl()).dump();
+    }
+
+    // WebSocket entry point
+    void handleWebSocket(websocketpp::connection_hdl hdl, const std::string& payload) {
+        json request;
+        std::string reply;
+        try {
+            request = json::parse(payload);
+        } catch (const json::exception&) {
+            reply = errorResponse(json::object(), RpcError{-32700, "Parse error"}).dump();
+        }
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        Session& session = sessions[hdl];
+        if (reply.empty()) {
+            reply = handle(request, session.authorized, &session, hdl).dump();
+        }
+        websocketpp::lib::error_code ec;
+        wsServer->send(hdl, reply, websocketpp::frame::opcode::text, ec);
+
+        for (const PendingSnapshot& snapshot : pendingSnapshots) {
+            std::string message = json{
+                {"jsonrpc", "2.0"},
+                {"method", "subscription"},
+                {"params", {{"channel", snapshot.channel}, {"data", snapshot.data}}}
+            }.dump();
+            wsServer->send(snapshot.hdl, message, websocketpp::frame::opcode::text, ec);
+        }
+        pendingSnapshots.clear();
+    }
+
+    void onOpen(websocketpp::connection_hdl hdl) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        sessions[hdl] = Session{};
+    }
+
+    void onClose(websocketpp::connection_hdl hdl) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        sessions.erase(hdl);
+    }
+
+    // Moves the book one step: occasionally shifts the mid by a tick,
+    // keeps 'depth' levels per side and resizes one resting level
+    void stepBook(const std::string& instrument) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        SyntheticBook& book = books.at(instrument);
+
+        int roll = std::uniform_int_distribution<int>(0, 9)(rng);
+        if (roll == 0) {
+            ++book.midTicks;
+        } else if (roll == 1) {
+            --book.midTicks;
+        }
+
+        json bidChanges = json::array();
+        json askChanges = json::array();
+        reshape(book, bidChanges, askChanges);
+
+        bool bidSide = std::uniform_int_distribution<int>(0, 1)(rng) == 0;
+        std::map<int64_t, double>& side = bidSide ? book.bids : book.asks;
+        if (!side.empty()) {
+            auto it = side.begin();
+            std::advance(it, std::uniform_int_distribution<size_t>(0, side.size() - 1)(rng));
+            it->second = randomAmount();
+            (bidSide ? bidChanges : askChanges).push_back({"change", book.price(it->first), it->second});
+        }
+
+        int64_t previous = book.changeId++;
+        json data = {
+            {"type", "change"},
+            {"timestamp", nowMillis()},
+            {"prev_change_id", previous},
+            {"change_id", book.changeId},
+            {"instrument_name", book.instrument},
+            {"bids", bidChanges},
+            {"asks", askChanges}
+        };
+        // The 100ms channel is not conflated here; it carries every delta
+        publish("book." + instrument + ".raw", data);
+        publish("book." + instrument + ".100ms", data);
+    }
+
+    // Prints one trade at the touch on a random side
+    void stepTrade(const std::string& instrument) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        SyntheticBook& book = books.at(instrument);
+        bool buy = std::uniform_int_distribution<int>(0, 1)(rng) == 0;
+        int64_t ticks = buy ? book.bestAsk() : book.bestBid();
+        if (ticks == 0) {
+            return;
+        }
+        json trade = {
+            {"trade_seq", ++book.tradeSeq},
+            {"trade_id", "MOCK-" + std::to_string(nextTradeId++)},
+            {"timestamp", nowMillis()},
+            {"tick_direction", ticks >= book.lastTradeTicks ? 0 : 2},
+            {"price", book.price(ticks)},
+            {"mark_price", book.price(book.midTicks)},
+            {"index_price", book.price(book.midTicks)},
+            {"instrument_name", book.instrument},
+            {"direction", buy ? "buy" : "sell"},
+            {"amount", randomAmount()}
+        };
+        book.lastTradeTicks = ticks;
+        publish("trades." + instrument + ".raw", json::array({trade}));
+        publish("trades." + instrument + ".100ms", json::array({trade}));
+    }
+};
+
+// --------------------------------------------------------------------
+// RestServer: HTTP/1.1 with keep-alive, one thread per connection
+// (fine for a handful of benchmark clients)
+// --------------------------------------------------------------------
+class RestServer {
+private:
+    MockExchange& exchange;
+    uint16_t port;
+    int listenFd = -1;
+    std::thread acceptThread;
+    std::mutex connectionsMutex;
+    std::vector<std::thread> connections;
+
+    static constexpr size_t kMaxRequestBytes = 1 << 20;
+
+    static bool sendAll(int fd, const std::string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    static std::string lower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+        return text;
+    }
+
+    static std::string reply(const char* status, const std::string& body, bool keepAlive) {
+        std::string out = std::string("HTTP/1.1 ") + status + "\r\n";
+        out += "Content-Type: application/json\r\n";
+        out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        out += keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+        out += body;
+        return out;
+    }
+
+    void serve(int fd) {
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        std::string buffer;
+        char chunk[16384];
+        while (g_running) {
+            // Read one request head
+            size_t headEnd;
+            while ((headEnd = buffer.find("\r\n\r\n")) == std::string::npos) {
+                if (buffer.size() > kMaxRequestBytes) {
+                    ::close(fd);
+                    return;
+                }
+                pollfd pfd{fd, POLLIN, 0};
+                if (::poll(&pfd, 1, 200) <= 0) {
+                    if (!g_running) {
+                        ::close(fd);
+                        return;
+                    }
+                    continue;
+                }
+                ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    ::close(fd);
+                    return;
+                }
+                buffer.append(chunk, static_cast<size_t>(n));
+            }
+
+            std::string head = buffer.substr(0, headEnd);
+            std::vector<std::string> lines = split(head, '\n');
+            std::string requestLine = lines.empty() ? "" : lines[0];
+            size_t contentLength = 0;
+            bool keepAlive = true;
+            bool authorized = false;
+            for (size_t i = 1; i < lines.size(); ++i) {
+                std::string line = lines[i];
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                size_t colon = line.find(':');
+                if (colon == std::string::npos) {
+                    continue;
+                }
+                std::string name = lower(line.substr(0, colon));
+                std::string value = line.substr(colon + 1);
+                value.erase(0, value.find_first_not_of(' '));
+                if (name == "content-length") {
+                    contentLength = static_cast<size_t>(std::strtoull(value.c_str(), nullptr, 10));
+                } else if (name == "connection") {
+                    keepAlive = lower(value) != "close";
+                } else if (name == "authorization") {
+                    authorized = value == std::string("Bearer ") + kAccessToken;
+                }
+            }
+            if (contentLength > kMaxRequestBytes) {
+                sendAll(fd, reply("413 Payload Too Large", "{}", false));
+                ::close(fd);
+                return;
+            }
+
+            // Then its body
+            size_t bodyStart = headEnd + 4;
+            while (buffer.size() < bodyStart + contentLength) {
+                ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+                if (n <= 0) {
+                    ::close(fd);
+                    return;
+                }
+                buffer.append(chunk, static_cast<size_t>(n));
+            }
+            std::string body = buffer.substr(bodyStart, contentLength);
+            buffer.erase(0, bodyStart + contentLength);
+
+            std::string out;
+            if (requestLine.compare(0, 5, "POST ") != 0) {
+                out = reply("405 Method Not Allowed", R"({"error":"POST a JSON-RPC request"})", keepAlive);
+            } else {
+                out = reply("200 OK", exchange.handleRest(body, authorized), keepAlive);
+            }
+            if (!sendAll(fd, out) || !keepAlive) {
+                break;
+            }
+        }
+        ::close(fd);
+    }
+
+public:
+    RestServer(MockExchange& ex, uint16_t listenPort) : exchange(ex), port(listenPort) {}
+
+    ~RestServer() {
+        stop();
+    }
+
+    bool start() {
+        listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd < 0) {
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listenFd, 64) < 0) {
+            std::cerr << "REST: cannot listen on 127.0.0.1:" << port << ": " << std::strerror(errno) << std::endl;
+            ::close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        acceptThread = std::thread([this]() {
+            while (g_running) {
+                pollfd pfd{listenFd, POLLIN, 0};
+                if (::poll(&pfd, 1, 200) <= 0) {
+                    continue;
+                }
+                int fd = ::accept(listenFd, nullptr, nullptr);
+                if (fd < 0) {
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(connectionsMutex);
+                connections.emplace_back([this, fd]() { serve(fd); });
+            }
+        });
+        return true;
+    }
+
+    void stop() {
+        if (acceptThread.joinable()) {
+            acceptThread.join();
+        }
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        for (std::thread& t : connections) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+        connections.clear();
+        if (listenFd >= 0) {
+            ::close(listenFd);
+            listenFd = -1;
+        }
+    }
+};
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--rest-port N] [--ws-port N] [--book-rate R] [--trade-rate R]\n"
+              << "       [--depth N] [--seed N] [--instruments A,B,...]" << std::endl;
+}
+
+static bool parseOptions(int argc, char** argv, MockOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--rest-port") {
+            options.restPort = static_cast<uint16_t>(std::atoi(value.c_str()));
+        } else if (arg == "--ws-port") {
+            options.wsPort = static_cast<uint16_t>(std::atoi(value.c_str()));
+        } else if (arg == "--book-rate") {
+            options.bookRate = std::atof(value.c_str());
+        } else if (arg == "--trade-rate") {
+            options.tradeRate = std::atof(value.c_str());
+        } else if (arg == "--depth") {
+            options.depth = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--seed") {
+            options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--instruments") {
+            options.instruments = split(value, ',');
+        } else {
+            return false;
+        }
+    }
+    return !options.instruments.empty() && options.bookRate >= 0 && options.tradeRate >= 0;
+}
+
+int main(int argc, char** argv) {
+    MockOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::signal(SIGINT, [](int) { g_running = false; });
+    std::signal(SIGTERM, [](int) { g_running = false; });
+
+    MockExchange exchange(options);
+
+    server ws;
+    ws.clear_access_channels(websocketpp::log::alevel::all);
+    ws.clear_error_channels(websocketpp::log::elevel::all);
+    ws.init_asio();
+    ws.set_reuse_addr(true);
+    exchange.setServer(&ws);
+    ws.set_open_handler([&](websocketpp::connection_hdl hdl) { exchange.onOpen(hdl); });
+    ws.set_close_handler([&](websocketpp::connection_hdl hdl) { exchange.onClose(hdl); });
+    ws.set_message_handler([&](websocketpp::connection_hdl hdl, server::message_ptr msg) {
+        exchange.handleWebSocket(hdl, msg->get_payload());
+    });
+
+    try {
+        ws.listen("127.0.0.1", std::to_string(options.wsPort));
+        ws.start_accept();
+    } catch (const std::exception& e) {
+        std::cerr << "WebSocket: cannot listen on 127.0.0.1:" << options.wsPort << ": " << e.what() << std::endl;
+        return 1;
+    }
+    std::thread wsThread([&]() {
+        try {
+            ws.run();
+        } catch (const std::exception& e) {
+            std::cerr << "WebSocket server error: " << e.what() << std::endl;
+        }
+    });
+
+    RestServer rest(exchange, options.restPort);
+    if (!rest.start()) {
+        g_running = false;
+    }
+
+    if (g_running) {
+        std::cout << "Mock exchange running\n"
+                  << "  DERIBIT_REST_URL=http://127.0.0.1:" << options.restPort << "/api/v2\n"
+                  << "  DERIBIT_WS_URL=ws://127.0.0.1:" << options.wsPort << "/ws/api/v2\n"
+                  << "  " << options.bookRate << " book deltas/s and " << options.tradeRate
+                  << " trades/s per instrument" << std::endl;
+    }
+
+    // Stream generator: each instrument's streams run on a fixed schedule;
+    // if we fall behind, catch up in bounded bursts
+    using clock = std::chrono::steady_clock;
+    auto period = [](double rate) {
+        return std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    };
+    std::vector<clock::time_point> nextBook(options.instruments.size(), clock::now());
+    std::vector<clock::time_point> nextTrade(options.instruments.size(), clock::now());
+    constexpr int kMaxBurst = 1000;
+    while (g_running) {
+        auto now = clock::now();
+        auto wake = now + std::chrono::milliseconds(100);
+        for (size_t i = 0; i < options.instruments.size(); ++i) {
+            if (options.bookRate > 0) {
+                for (int n = 0; nextBook[i] <= now && n < kMaxBurst; ++n) {
+                    exchange.stepBook(options.instruments[i]);
+                    nextBook[i] += period(options.bookRate);
+                }
+                wake = std::min(wake, nextBook[i]);
+            }
+            if (options.tradeRate > 0) {
+                for (int n = 0; nextTrade[i] <= now && n < kMaxBurst; ++n) {
+                    exchange.stepTrade(options.instruments[i]);
+                    nextTrade[i] += period(options.tradeRate);
+                }
+                wake = std::min(wake, nextTrade[i]);
+            }
+        }
+        std::this_thread::sleep_until(wake);
+    }
+
+    std::cout << "Shutting down" << std::endl;
+    websocketpp::lib::error_code ec;
+    ws.stop_listening(ec);
+    ws.stop();
+    if (wsThread.joinable()) {
+        wsThread.join();
+    }
+    rest.stop();
+    return 0;
+}
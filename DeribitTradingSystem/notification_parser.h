@@ -0,0 +1,626 @@
+#ifndef NOTIFICATION_PARSER_H
+#define NOTIFICATION_PARSER_H
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include "order_book.h"
+
+// --------------------------------------------------------------------
+// Decoded subscription notifications
+//   Everything here is plain data in fixed-size arrays, owned by the
+//   parser and reused for every message. String fields are views into
+//   the payload being parsed, so they are only valid inside the callback.
+// --------------------------------------------------------------------
+enum class NotificationKind {
+    Invalid,      // not well-formed JSON (or not an object)
+    RpcResponse,  // has an "id": a reply to one of our requests
+    Book,         // book.*
+    Trades,       // trades.*
+    Ticker,       // ticker.*
+    User,         // user.*
+    Other         // any other subscription channel, or a non-subscription method
+};
+
+enum class TradeDirection : uint8_t { Unknown, Buy, Sell };
+
+struct BookNotification {
+    static constexpr size_t kMaxEntries = 1024;
+
+    std::string_view instrument;
+    bool isSnapshot = false;
+    bool truncated = false;
+    int64_t timestamp = 0;
+    int64_t changeId = 0;
+    int64_t prevChangeId = 0;
+    uint32_t bidCount = 0;
+    uint32_t askCount = 0;
+    std::array<LevelUpdate, kMaxEntries> bids;
+    std::array<LevelUpdate, kMaxEntries> asks;
+
+    BookUpdateView view() const {
+        BookUpdateView v;
+        v.bids = bids.data();
+        v.bidCount = bidCount;
+        v.asks = asks.data();
+        v.askCount = askCount;
+        v.timestamp = timestamp;
+        v.changeId = changeId;
+        v.prevChangeId = prevChangeId;
+        v.isSnapshot = isSnapshot;
+        v.truncated = truncated;
+        return v;
+    }
+};
+
+struct TradeEntry {
+    std::string_view instrument;
+    std::string_view tradeId;
+    int64_t price = 0;   // fixed-point, see kPriceScale
+    double amount = 0.0;
+    TradeDirection direction = TradeDirection::Unknown;
+    int64_t timestamp = 0;
+    int64_t tradeSeq = 0;
+};
+
+struct TradesNotification {
+    static constexpr size_t kMaxTrades = 256;
+
+    uint32_t count = 0;
+    bool truncated = false;
+    std::array<TradeEntry, kMaxTrades> trades;
+};
+
+struct TickerNotification {
+    std::string_view instrument;
+    int64_t timestamp = 0;
+    double bestBidPrice = 0.0;
+    double bestBidAmount = 0.0;
+    double bestAskPrice = 0.0;
+    double bestAskAmount = 0.0;
+    double lastPrice = 0.0;
+    double markPrice = 0.0;
+    double indexPrice = 0.0;
+    double openInterest = 0.0;
+};
+
+// One entry of user.orders.* or user.trades.*
+struct OrderEvent {
+    std::string_view orderId;
+    std::string_view instrument;
+    std::string_view orderState;  // user.orders only
+    std::string_view tradeId;     // user.trades only
+    std::string_view label;
+    TradeDirection direction = TradeDirection::Unknown;
+    double price = 0.0;           // NaN for market orders
+    double amount = 0.0;
+    double filledAmount = 0.0;
+    int64_t timestamp = 0;
+};
+
+struct UserNotification {
+    static constexpr size_t kMaxEvents = 64;
+
+    std::string_view data;        // raw JSON text of params.data
+    uint32_t count = 0;           // decoded events (user.orders / user.trades)
+    bool truncated = false;
+    std::array<OrderEvent, kMaxEvents> events;
+};
+
+// --------------------------------------------------------------------
+// NotificationParser: single-pass scanner for Deribit notifications
+//   Walks the payload once, pulls out params.channel and decodes
+//   params.data for the channel families we care about straight into
+//   the structs above. Never allocates. RPC responses and anything it
+//   does not recognise are reported as such so the caller can fall back
+//   to nlohmann::json.
+// --------------------------------------------------------------------
+class NotificationParser {
+private:
+    const char* p = nullptr;
+    const char* end = nullptr;
+
+    NotificationKind kind = NotificationKind::Invalid;
+    std::string_view channel;
+    std::string_view dataText;
+
+    BookNotification book;
+    TradesNotification trades;
+    TickerNotification ticker;
+    UserNotification user;
+
+    static bool startsWith(std::string_view s, std::string_view prefix) {
+        return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    static TradeDirection toDirection(std::string_view s) {
+        if (s == "buy") return TradeDirection::Buy;
+        if (s == "sell") return TradeDirection::Sell;
+        return TradeDirection::Unknown;
+    }
+
+    // ----------------------------------------------------------------
+    // Scanner primitives
+    // ----------------------------------------------------------------
+    void skipWhitespace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            ++p;
+        }
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (p < end && *p == c) {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    bool peek(char c) {
+        skipWhitespace();
+        return p < end && *p == c;
+    }
+
+    // Returns the raw (still escaped) contents between the quotes
+    bool parseString(std::string_view& out) {
+        if (!consume('"')) {
+            return false;
+        }
+        const char* start = p;
+        while (p < end && *p != '"') {
+            if (*p == '\\') {
+                ++p;
+            }
+            ++p;
+        }
+        if (p >= end) {
+            return false;
+        }
+        out = std::string_view(start, static_cast<size_t>(p - start));
+        ++p;
+        return true;
+    }
+
+    bool parseLiteral(std::string_view literal) {
+        if (static_cast<size_t>(end - p) < literal.size() ||
+            std::string_view(p, literal.size()) != literal) {
+            return false;
+        }
+        p += literal.size();
+        return true;
+    }
+
+    // Numbers; null and strings (e.g. "market_price") decode as NaN
+    bool parseDouble(double& out) {
+        skipWhitespace();
+        if (p < end && (*p == 'n' || *p == '"')) {
+            out = std::numeric_limits<double>::quiet_NaN();
+            return skipValue();
+        }
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        return true;
+    }
+
+    bool parseInt(int64_t& out) {
+        skipWhitespace();
+        if (p < end && *p == 'n') {
+            out = 0;
+            return parseLiteral("null");
+        }
+        const char* start = p;
+        auto result = std::from_chars(p, end, out);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        p = result.ptr;
+        if (p < end && (*p == '.' || *p == 'e' || *p == 'E')) {
+            // Integral field sent as a float; re-read it as one
+            p = start;
+            double value = 0.0;
+            if (!parseDouble(value)) {
+                return false;
+            }
+            out = static_cast<int64_t>(value);
+        }
+        return true;
+    }
+
+    // Decimal text straight to fixed-point, without going through double
+    // when the value has at most 8 decimals and no exponent
+    bool parsePrice(int64_t& out) {
+        skipWhitespace();
+        const char* start = p;
+        const char* q = p;
+        bool negative = false;
+        if (q < end && *q == '-') {
+            negative = true;
+            ++q;
+        }
+
+        int64_t integral = 0;
+        const char* digitsStart = q;
+        while (q < end && *q >= '0' && *q <= '9') {
+            integral = integral * 10 + (*q - '0');
+            ++q;
+        }
+        int digits = static_cast<int>(q - digitsStart);
+
+        int64_t fraction = 0;
+        int fractionDigits = 0;
+        if (q < end && *q == '.') {
+            ++q;
+            while (q < end && *q >= '0' && *q <= '9' && fractionDigits < 8) {
+                fraction = fraction * 10 + (*q - '0');
+                ++fractionDigits;
+                ++q;
+            }
+        }
+
+        bool simple = digits > 0 && digits <= 10 &&
+                      !(q < end && (*q == 'e' || *q == 'E' || (*q >= '0' && *q <= '9')));
+        if (!simple) {
+            p = start;
+            double value = 0.0;
+            if (!parseDouble(value)) {
+                return false;
+            }
+            out = std::isnan(value) ? 0 : toFixedPrice(value);
+            return true;
+        }
+
+        static constexpr int64_t kPow10[] = {100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1};
+        int64_t value = integral * kPriceScale + fraction * kPow10[fractionDigits];
+        out = negative ? -value : value;
+        p = q;
+        return true;
+    }
+
+    // Skips any JSON value, including nested objects and arrays
+    bool skipValue() {
+        skipWhitespace();
+        if (p >= end) {
+            return false;
+        }
+        switch (*p) {
+            case '"': {
+                std::string_view ignored;
+                return parseString(ignored);
+            }
+            case '{':
+            case '[': {
+                int depth = 0;
+                while (p < end) {
+                    char c = *p;
+                    if (c == '"') {
+                        std::string_view ignored;
+                        if (!parseString(ignored)) {
+                            return false;
+                        }
+                        continue;
+                    }
+                    ++p;
+                    if (c == '{' || c == '[') {
+                        ++depth;
+                    } else if (c == '}' || c == ']') {
+                        if (--depth == 0) {
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+            case 't': return parseLiteral("true");
+            case 'f': return parseLiteral("false");
+            case 'n': return parseLiteral("null");
+            default: {
+                double ignored;
+                auto result = std::from_chars(p, end, ignored);
+                if (result.ec != std::errc()) {
+                    return false;
+                }
+                p = result.ptr;
+                return true;
+            }
+        }
+    }
+
+    // Calls onMember(key) for each member; the callback must consume the value
+    template <typename F>
+    bool parseObject(F&& onMember) {
+        if (!consume('{')) {
+            return false;
+        }
+        if (consume('}')) {
+            return true;
+        }
+        do {
+            std::string_view key;
+            if (!parseString(key) || !consume(':') || !onMember(key)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume('}');
+    }
+
+    // Calls onElement(index) for each element; the callback must consume the value
+    template <typename F>
+    bool parseArray(F&& onElement) {
+        if (!consume('[')) {
+            return false;
+        }
+        if (consume(']')) {
+            return true;
+        }
+        size_t index = 0;
+        do {
+            if (!onElement(index++)) {
+                return false;
+            }
+        } while (consume(','));
+        return consume(']');
+    }
+
+    // ----------------------------------------------------------------
+    // Channel decoders
+    // ----------------------------------------------------------------
+    bool parseLevels(std::array<LevelUpdate, BookNotification::kMaxEntries>& levels, uint32_t& count) {
+        count = 0;
+        return parseArray([&](size_t) {
+            if (count >= BookNotification::kMaxEntries) {
+                book.truncated = true;
+                return skipValue();
+            }
+            LevelUpdate& level = levels[count];
+            level.action = LevelAction::New;
+            if (!consume('[')) {
+                return false;
+            }
+            if (peek('"')) {
+                std::string_view action;
+                if (!parseString(action) || !consume(',')) {
+                    return false;
+                }
+                level.action = action == "delete" ? LevelAction::Delete
+                             : action == "change" ? LevelAction::Change
+                             : LevelAction::New;
+            }
+            if (!parsePrice(level.price) || !consume(',') || !parseDouble(level.amount) || !consume(']')) {
+                return false;
+            }
+            ++count;
+            return true;
+        });
+    }
+
+    bool decodeBook() {
+        book.instrument = {};
+        book.isSnapshot = true;  // grouped channels carry no type and are always full books
+        book.truncated = false;
+        book.timestamp = book.changeId = book.prevChangeId = 0;
+        book.bidCount = book.askCount = 0;
+        return parseObject([&](std::string_view key) {
+            if (key == "bids") return parseLevels(book.bids, book.bidCount);
+            if (key == "asks") return parseLevels(book.asks, book.askCount);
+            if (key == "change_id") return parseInt(book.changeId);
+            if (key == "prev_change_id") return parseInt(book.prevChangeId);
+            if (key == "timestamp") return parseInt(book.timestamp);
+            if (key == "instrument_name") return parseString(book.instrument);
+            if (key == "type") {
+                std::string_view type;
+                if (!parseString(type)) return false;
+                book.isSnapshot = type == "snapshot";
+                return true;
+            }
+            return skipValue();
+        });
+    }
+
+    bool decodeTrades() {
+        trades.count = 0;
+        trades.truncated = false;
+        return parseArray([&](size_t) {
+            if (trades.count >= TradesNotification::kMaxTrades) {
+                trades.truncated = true;
+                return skipValue();
+            }
+            TradeEntry& trade = trades.trades[trades.count];
+            trade = TradeEntry{};
+            bool ok = parseObject([&](std::string_view key) {
+                if (key == "price") return parsePrice(trade.price);
+                if (key == "amount") return parseDouble(trade.amount);
+                if (key == "timestamp") return parseInt(trade.timestamp);
+                if (key == "trade_seq") return parseInt(trade.tradeSeq);
+                if (key == "trade_id") return parseString(trade.tradeId);
+                if (key == "instrument_name") return parseString(trade.instrument);
+                if (key == "direction") {
+                    std::string_view direction;
+                    if (!parseString(direction)) return false;
+                    trade.direction = toDirection(direction);
+                    return true;
+                }
+                return skipValue();
+            });
+            ++trades.count;
+            return ok;
+        });
+    }
+
+    bool decodeTicker() {
+        ticker = TickerNotification{};
+        return parseObject([&](std::string_view key) {
+            if (key == "best_bid_price") return parseDouble(ticker.bestBidPrice);
+            if (key == "best_bid_amount") return parseDouble(ticker.bestBidAmount);
+            if (key == "best_ask_price") return parseDouble(ticker.bestAskPrice);
+            if (key == "best_ask_amount") return parseDouble(ticker.bestAskAmount);
+            if (key == "last_price") return parseDouble(ticker.lastPrice);
+            if (key == "mark_price") return parseDouble(ticker.markPrice);
+            if (key == "index_price") return parseDouble(ticker.indexPrice);
+            if (key == "open_interest") return parseDouble(ticker.openInterest);
+            if (key == "timestamp") return parseInt(ticker.timestamp);
+            if (key == "instrument_name") return parseString(ticker.instrument);
+            return skipValue();
+        });
+    }
+
+    bool decodeOrderEvent() {
+        if (user.count >= UserNotification::kMaxEvents) {
+            user.truncated = true;
+            return skipValue();
+        }
+        OrderEvent& event = user.events[user.count];
+        event = OrderEvent{};
+        bool ok = parseObject([&](std::string_view key) {
+            if (key == "order_id") return parseString(event.orderId);
+            if (key == "instrument_name") return parseString(event.instrument);
+            if (key == "order_state" || key == "state") return parseString(event.orderState);
+            if (key == "trade_id") return parseString(event.tradeId);
+            if (key == "label") return parseString(event.label);
+            if (key == "price") return parseDouble(event.price);
+            if (key == "amount") return parseDouble(event.amount);
+            if (key == "filled_amount") return parseDouble(event.filledAmount);
+            if (key == "timestamp" || key == "last_update_timestamp") return parseInt(event.timestamp);
+            if (key == "direction") {
+                std::string_view direction;
+                if (!parseString(direction)) return false;
+                event.direction = toDirection(direction);
+                return true;
+            }
+            return skipValue();
+        });
+        ++user.count;
+        return ok;
+    }
+
+    bool decodeUser() {
+        user.count = 0;
+        user.truncated = false;
+        const char* start = p;
+        bool ok;
+        if (startsWith(channel, "user.orders") || startsWith(channel, "user.trades")) {
+            // Single object for .raw channels, array for batched intervals
+            ok = peek('[') ? parseArray([&](size_t) { return decodeOrderEvent(); })
+                           : decodeOrderEvent();
+        } else {
+            ok = skipValue();
+        }
+        skipWhitespace();
+        user.data = std::string_view(start, static_cast<size_t>(p - start));
+        return ok;
+    }
+
+    // Decodes params.data according to the channel family
+    bool decodeData() {
+        skipWhitespace();
+        const char* start = p;
+        bool ok;
+        if (startsWith(channel, "book.")) {
+            kind = NotificationKind::Book;
+            ok = decodeBook();
+        } else if (startsWith(channel, "trades.")) {
+            kind = NotificationKind::Trades;
+            ok = decodeTrades();
+        } else if (startsWith(channel, "ticker.")) {
+            kind = NotificationKind::Ticker;
+            ok = decodeTicker();
+        } else if (startsWith(channel, "user.")) {
+            kind = NotificationKind::User;
+            ok = decodeUser();
+        } else {
+            kind = NotificationKind::Other;
+            ok = skipValue();
+        }
+        dataText = std::string_view(start, static_cast<size_t>(p - start));
+        return ok;
+    }
+
+    bool parseParams() {
+        const char* dataStart = nullptr;
+        const char* dataEnd = nullptr;
+        bool ok = parseObject([&](std::string_view key) {
+            if (key == "channel") {
+                return parseString(channel);
+            }
+            if (key == "data") {
+                if (!channel.empty()) {
+                    return decodeData();
+                }
+                // Channel comes later; remember where the data is
+                skipWhitespace();
+                dataStart = p;
+                bool skipped = skipValue();
+                dataEnd = p;
+                return skipped;
+            }
+            return skipValue();
+        });
+        if (ok && dataStart != nullptr && !channel.empty()) {
+            const char* resume = p;
+            const char* savedEnd = end;
+            p = dataStart;
+            end = dataEnd;
+            ok = decodeData();
+            p = resume;
+            end = savedEnd;
+        }
+        return ok;
+    }
+
+public:
+    // Parses one WebSocket payload. The decoded struct matching the
+    // returned kind is valid until the next call (and only as long as
+    // the payload buffer is).
+    NotificationKind parse(std::string_view payload) {
+        p = payload.data();
+        end = payload.data() + payload.size();
+        kind = NotificationKind::Other;
+        channel = {};
+        dataText = {};
+
+        bool hasId = false;
+        bool isSubscription = false;
+        bool ok = parseObject([&](std::string_view key) {
+            if (key == "id") {
+                hasId = true;
+                return skipValue();
+            }
+            if (key == "method") {
+                std::string_view method;
+                if (!parseString(method)) return false;
+                isSubscription = method == "subscription";
+                return true;
+            }
+            if (key == "params") {
+                return peek('{') ? parseParams() : skipValue();
+            }
+            return skipValue();
+        });
+
+        if (!ok) {
+            kind = NotificationKind::Invalid;
+        } else if (hasId) {
+            kind = NotificationKind::RpcResponse;
+        } else if (!isSubscription || channel.empty()) {
+            kind = NotificationKind::Other;
+        }
+        return kind;
+    }
+
+    NotificationKind getKind() const { return kind; }
+    std::string_view getChannel() const { return channel; }
+    std::string_view getDataText() const { return dataText; }
+
+    const BookNotification& getBook() const { return book; }
+    const TradesNotification& getTrades() const { return trades; }
+    const TickerNotification& getTicker() const { return ticker; }
+    const UserNotification& getUser() const { return user; }
+};
+
+#endif // NOTIFICATION_PARSER_H
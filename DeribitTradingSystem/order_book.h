@@ -0,0 +1,300 @@
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include "cpu_relax.h"
+
+using json = nlohmann::json;
+
+// --------------------------------------------------------------------
+// Fixed-point price helpers
+//   Deribit quotes prices as doubles (e.g. 62345.5 for BTC-PERPETUAL,
+//   0.0005 for options). We keep them as integers with 8 decimal places
+//   so comparisons and level lookups never touch floating point.
+// --------------------------------------------------------------------
+constexpr int64_t kPriceScale = 100000000;
+
+inline int64_t toFixedPrice(double price) {
+    return static_cast<int64_t>(std::llround(price * kPriceScale));
+}
+
+inline double fromFixedPrice(int64_t price) {
+    return static_cast<double>(price) / kPriceScale;
+}
+
+struct PriceLevel {
+    int64_t price = 0;   // fixed-point, see kPriceScale
+    double amount = 0.0;
+};
+
+enum class BookSide { Bid, Ask };
+
+enum class LevelAction : uint8_t { New, Change, Delete };
+
+// One entry of a book notification: ["new"|"change"|"delete", price, amount]
+struct LevelUpdate {
+    int64_t price = 0;   // fixed-point, see kPriceScale
+    double amount = 0.0;
+    LevelAction action = LevelAction::New;
+};
+
+// A decoded book update that does not own its level arrays; produced by
+// the notification parser (pointing at its buffers) or by a BookDelta
+struct BookUpdateView {
+    const LevelUpdate* bids = nullptr;
+    size_t bidCount = 0;
+    const LevelUpdate* asks = nullptr;
+    size_t askCount = 0;
+    int64_t timestamp = 0;
+    int64_t changeId = 0;
+    int64_t prevChangeId = 0;
+    bool isSnapshot = false;
+    bool truncated = false;  // decoder ran out of room; some levels are missing
+};
+
+// --------------------------------------------------------------------
+// OrderBook: L2 book for a single instrument
+//   - Each side is a flat, sorted array of price levels (best first),
+//     so the top of book is always index 0 and depth-N is a memcpy.
+//   - Written in place by the WebSocket IO thread only.
+//   - Readers on any thread use a seqlock: no mutex, no allocation,
+//     they simply retry if a write overlapped their read.
+// --------------------------------------------------------------------
+class OrderBook {
+public:
+    // Levels beyond this depth are dropped; the far end of the book is
+    // irrelevant for trading decisions and keeps each side cache-sized.
+    static constexpr size_t kMaxLevels = 512;
+
+    // Both sides plus the change id they correspond to, as of one instant
+    struct Snapshot {
+        std::array<PriceLevel, kMaxLevels> bids;
+        std::array<PriceLevel, kMaxLevels> asks;
+        size_t bidCount = 0;
+        size_t askCount = 0;
+        int64_t changeId = 0;
+        int64_t timestamp = 0;
+        uint64_t updateCount = 0;  // updates applied so far; 0 = never populated
+    };
+
+private:
+    struct Side {
+        std::array<PriceLevel, kMaxLevels> levels;
+        uint32_t count = 0;
+    };
+
+    std::string instrument;
+
+    alignas(64) std::atomic<uint64_t> sequence{0}; // odd while a write is in progress
+    int64_t changeId = 0;
+    int64_t timestamp = 0;   // exchange timestamp of the last update (ms)
+    uint64_t updateCount = 0;
+
+    alignas(64) Side bids;   // highest price first
+    alignas(64) Side asks;   // lowest price first
+
+    Side& sideFor(BookSide side) { return side == BookSide::Bid ? bids : asks; }
+    const Side& sideFor(BookSide side) const { return side == BookSide::Bid ? bids : asks; }
+
+    // Returns true if price 'a' ranks ahead of price 'b' on the given side
+    static bool better(BookSide side, int64_t a, int64_t b) {
+        return side == BookSide::Bid ? a > b : a < b;
+    }
+
+    // Index of the first level that does not rank ahead of 'price'
+    static uint32_t lowerBound(BookSide side, const Side& s, int64_t price) {
+        uint32_t lo = 0, hi = s.count;
+        while (lo < hi) {
+            uint32_t mid = (lo + hi) / 2;
+            if (better(side, s.levels[mid].price, price)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    void setLevel(BookSide side, int64_t price, double amount) {
+        Side& s = sideFor(side);
+        uint32_t idx = lowerBound(side, s, price);
+        bool found = idx < s.count && s.levels[idx].price == price;
+
+        if (amount <= 0.0) {
+            if (found) {
+                std::memmove(&s.levels[idx], &s.levels[idx + 1],
+                             (s.count - idx - 1) * sizeof(PriceLevel));
+                --s.count;
+            }
+            return;
+        }
+
+        if (found) {
+            s.levels[idx].amount = amount;
+            return;
+        }
+
+        if (idx >= kMaxLevels) {
+            return; // worse than everything we track
+        }
+
+        uint32_t toMove = std::min<uint32_t>(s.count, kMaxLevels - 1) - idx;
+        std::memmove(&s.levels[idx + 1], &s.levels[idx], toMove * sizeof(PriceLevel));
+        s.levels[idx] = PriceLevel{price, amount};
+        if (s.count < kMaxLevels) {
+            ++s.count;
+        }
+    }
+
+    // Seqlock read: re-run 'f' until it observed a consistent book
+    template <typename F>
+    auto read(F&& f) const {
+        for (;;) {
+            uint64_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                cpuRelax();
+                continue;
+            }
+            auto result = f();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                return result;
+            }
+        }
+    }
+
+public:
+    explicit OrderBook(std::string instrumentName) : instrument(std::move(instrumentName)) {}
+
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
+
+    const std::string& getInstrument() const { return instrument; }
+
+    // ----------------------------------------------------------------
+    // Writer side (WebSocket IO thread only)
+    // ----------------------------------------------------------------
+    void beginUpdate() {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endUpdate() {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void clear() {
+        bids.count = 0;
+        asks.count = 0;
+    }
+
+    // Apply a decoded book.* update in place. Snapshots replace the
+    // whole book; changes are applied level by level.
+    void applyUpdate(const BookUpdateView& update) {
+        beginUpdate();
+
+        if (update.isSnapshot) {
+            clear();
+        }
+        for (size_t i = 0; i < update.bidCount; ++i) {
+            const LevelUpdate& level = update.bids[i];
+            setLevel(BookSide::Bid, level.price, level.action == LevelAction::Delete ? 0.0 : level.amount);
+        }
+        for (size_t i = 0; i < update.askCount; ++i) {
+            const LevelUpdate& level = update.asks[i];
+            setLevel(BookSide::Ask, level.price, level.action == LevelAction::Delete ? 0.0 : level.amount);
+        }
+
+        changeId = update.changeId;
+        if (update.timestamp != 0) {
+            timestamp = update.timestamp;
+        }
+        ++updateCount;
+
+        endUpdate();
+    }
+
+    // ----------------------------------------------------------------
+    // Reader side (any thread, lock-free)
+    // ----------------------------------------------------------------
+    bool bestBid(PriceLevel& out) const { return depth(BookSide::Bid, &out, 1) == 1; }
+    bool bestAsk(PriceLevel& out) const { return depth(BookSide::Ask, &out, 1) == 1; }
+
+    // Copies up to maxLevels levels (best first) into 'out'; returns how many were copied
+    size_t depth(BookSide side, PriceLevel* out, size_t maxLevels) const {
+        const Side& s = sideFor(side);
+        return read([&]() {
+            size_t n = std::min<size_t>(maxLevels, std::min<uint32_t>(s.count, kMaxLevels));
+            std::memcpy(out, s.levels.data(), n * sizeof(PriceLevel));
+            return n;
+        });
+    }
+
+    // Total size resting on the best 'levels' levels of a side
+    double cumulativeSize(BookSide side, size_t levels) const {
+        const Side& s = sideFor(side);
+        return read([&]() {
+            size_t n = std::min<size_t>(levels, std::min<uint32_t>(s.count, kMaxLevels));
+            double total = 0.0;
+            for (size_t i = 0; i < n; ++i) {
+                total += s.levels[i].amount;
+            }
+            return total;
+        });
+    }
+
+    size_t levelCount(BookSide side) const {
+        const Side& s = sideFor(side);
+        return read([&]() { return static_cast<size_t>(s.count); });
+    }
+
+    // Copies up to maxLevels levels per side in a single consistent read.
+    // 'out' is ~16KB; keep one around rather than putting it on the stack.
+    void snapshot(Snapshot& out, size_t maxLevels = kMaxLevels) const {
+        read([&]() {
+            out.bidCount = std::min<size_t>(maxLevels, std::min<uint32_t>(bids.count, kMaxLevels));
+            out.askCount = std::min<size_t>(maxLevels, std::min<uint32_t>(asks.count, kMaxLevels));
+            std::memcpy(out.bids.data(), bids.levels.data(), out.bidCount * sizeof(PriceLevel));
+            std::memcpy(out.asks.data(), asks.levels.data(), out.askCount * sizeof(PriceLevel));
+            out.changeId = changeId;
+            out.timestamp = timestamp;
+            out.updateCount = updateCount;
+            return true;
+        });
+    }
+
+    int64_t getChangeId() const { return read([&]() { return changeId; }); }
+    int64_t getTimestamp() const { return read([&]() { return timestamp; }); }
+    uint64_t getUpdateCount() const { return read([&]() { return updateCount; }); }
+
+    // Render the top of the book as JSON (for display, not for the hot path)
+    json toJson(size_t maxLevels = 10) const {
+        std::array<PriceLevel, kMaxLevels> levels;
+        json result = {
+            {"instrument_name", instrument},
+            {"timestamp", getTimestamp()},
+            {"change_id", getChangeId()},
+            {"bids", json::array()},
+            {"asks", json::array()}
+        };
+
+        size_t n = depth(BookSide::Bid, levels.data(), std::min(maxLevels, kMaxLevels));
+        for (size_t i = 0; i < n; ++i) {
+            result["bids"].push_back({fromFixedPrice(levels[i].price), levels[i].amount});
+        }
+        n = depth(BookSide::Ask, levels.data(), std::min(maxLevels, kMaxLevels));
+        for (size_t i = 0; i < n; ++i) {
+            result["asks"].push_back({fromFixedPrice(levels[i].price), levels[i].amount});
+        }
+        return result;
+    }
+};
+
+#endif // ORDER_BOOK_H
@@ -0,0 +1,111 @@
+// --------------------------------------------------------------------
+// Order encode microbenchmark
+//   Compares building + dump()ing a nlohmann::json request (the old
+//   order path) against rendering it from an OrderRequestEncoder template.
+//
+//   Build:  g++ -std=c++17 -O2 -Iinclude order_encode_benchmark.cpp -o order_encode_benchmark
+//   Run:    ./order_encode_benchmark [iterations]
+// --------------------------------------------------------------------
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "order_templates.h"
+
+using json = nlohmann::json;
+using namespace std::chrono;
+
+// Keeps the optimizer from discarding the encoded output
+static volatile size_t sink;
+
+template <typename F>
+double nanosPerOp(size_t iterations, F&& f) {
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        f(i);
+    }
+    auto end = steady_clock::now();
+    return duration_cast<nanoseconds>(end - start).count() / static_cast<double>(iterations);
+}
+
+void report(const std::string& name, double jsonNanos, double templateNanos) {
+    std::cout << std::left << std::setw(10) << name << std::fixed << std::setprecision(1)
+              << std::setw(14) << jsonNanos << std::setw(14) << templateNanos
+              << jsonNanos / templateNanos << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::string instrument = "BTC-PERPETUAL";
+    const std::string orderId = "ETH-3452187654";
+    OrderRequestEncoder encoder;
+
+    // Vary price and amount so neither path formats the same number twice
+    auto priceOf = [](size_t i) { return 42000.5 + static_cast<double>(i % 1000) * 0.5; };
+    auto amountOf = [](size_t i) { return 10.0 + static_cast<double>(i % 100); };
+
+    // Both paths must produce equivalent requests
+    json expected = json::parse(std::string(encoder.encodeLimitOrder(true, instrument, priceOf(7), amountOf(7), 7)));
+    if (expected["params"]["price"].get<double>() != priceOf(7) || expected["id"].get<uint64_t>() != 7) {
+        std::cerr << "Template output does not round-trip: " << expected.dump() << std::endl;
+        return 1;
+    }
+
+    double buyJson = nanosPerOp(iterations, [&](size_t i) {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", i},
+            {"method", "private/buy"},
+            {"params", {
+                {"instrument_name", instrument},
+                {"amount", amountOf(i)},
+                {"price", priceOf(i)},
+                {"type", "limit"}
+            }}
+        };
+        sink = request.dump().size();
+    });
+    double buyTemplate = nanosPerOp(iterations, [&](size_t i) {
+        sink = encoder.encodeLimitOrder(true, instrument, priceOf(i), amountOf(i), i).size();
+    });
+
+    double cancelJson = nanosPerOp(iterations, [&](size_t i) {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", i},
+            {"method", "private/cancel"},
+            {"params", {{"order_id", orderId}}}
+        };
+        sink = request.dump().size();
+    });
+    double cancelTemplate = nanosPerOp(iterations, [&](size_t i) {
+        sink = encoder.encodeCancel(orderId, i).size();
+    });
+
+    double editJson = nanosPerOp(iterations, [&](size_t i) {
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", i},
+            {"method", "private/edit"},
+            {"params", {
+                {"order_id", orderId},
+                {"price", priceOf(i)},
+                {"amount", amountOf(i)}
+            }}
+        };
+        sink = request.dump().size();
+    });
+    double editTemplate = nanosPerOp(iterations, [&](size_t i) {
+        sink = encoder.encodeEdit(orderId, priceOf(i), amountOf(i), i).size();
+    });
+
+    std::cout << iterations << " iterations" << std::endl;
+    std::cout << std::left << std::setw(10) << "method" << std::setw(14) << "json (ns)"
+              << std::setw(14) << "template (ns)" << "speedup" << std::endl;
+    report("buy", buyJson, buyTemplate);
+    report("cancel", cancelJson, cancelTemplate);
+    report("edit", editJson, editTemplate);
+    return 0;
+}
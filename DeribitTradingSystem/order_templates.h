@@ -0,0 +1,152 @@
+#ifndef ORDER_TEMPLATES_H
+#define ORDER_TEMPLATES_H
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// --------------------------------------------------------------------
+// RequestTemplate: a pre-rendered JSON-RPC request in a fixed buffer
+//   The constant head ({"jsonrpc":"2.0","method":...,"params":{...) is
+//   written once at construction and never touched again. Each encode
+//   rewinds to the end of the head and appends only the variable fields
+//   with std::to_chars, so there is no allocation and no JSON tree.
+// --------------------------------------------------------------------
+class RequestTemplate {
+public:
+    static constexpr size_t kCapacity = 512;
+
+private:
+    std::array<char, kCapacity> buffer;
+    size_t headLength = 0;
+    size_t length = 0;
+    bool overflowed = false;
+
+    bool reserve(size_t n) {
+        if (length + n > kCapacity) {
+            overflowed = true;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    explicit RequestTemplate(std::string_view head) {
+        std::memcpy(buffer.data(), head.data(), head.size());
+        headLength = length = head.size();
+    }
+
+    void rewind() {
+        length = headLength;
+        overflowed = false;
+    }
+
+    void append(std::string_view text) {
+        if (reserve(text.size())) {
+            std::memcpy(buffer.data() + length, text.data(), text.size());
+            length += text.size();
+        }
+    }
+
+    // Strings are copied verbatim, so reject anything that would need
+    // escaping (instrument names and order ids never do)
+    void appendString(std::string_view text) {
+        for (char c : text) {
+            if (c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+                overflowed = true;
+                return;
+            }
+        }
+        append(text);
+    }
+
+    void appendInt(uint64_t value) {
+        auto [end, ec] = std::to_chars(buffer.data() + length, buffer.data() + kCapacity, value);
+        if (ec != std::errc()) {
+            overflowed = true;
+            return;
+        }
+        length = end - buffer.data();
+    }
+
+    // Shortest representation that round-trips; NaN/inf are not valid JSON
+    void appendNumber(double value) {
+        if (!std::isfinite(value)) {
+            overflowed = true;
+            return;
+        }
+        auto [end, ec] = std::to_chars(buffer.data() + length, buffer.data() + kCapacity, value);
+        if (ec != std::errc()) {
+            overflowed = true;
+            return;
+        }
+        length = end - buffer.data();
+    }
+
+    // Empty if any field was invalid or did not fit
+    std::string_view view() const {
+        return overflowed ? std::string_view() : std::string_view(buffer.data(), length);
+    }
+};
+
+// --------------------------------------------------------------------
+// OrderRequestEncoder: order entry requests without nlohmann::json
+//   One template per method. The returned view points into the encoder
+//   and stays valid until the next encode of the same method, so each
+//   sending thread needs its own encoder.
+// --------------------------------------------------------------------
+class OrderRequestEncoder {
+private:
+    RequestTemplate buyTemplate{
+        R"({"jsonrpc":"2.0","method":"private/buy","params":{"type":"limit","instrument_name":")"};
+    RequestTemplate sellTemplate{
+        R"({"jsonrpc":"2.0","method":"private/sell","params":{"type":"limit","instrument_name":")"};
+    RequestTemplate cancelTemplate{
+        R"({"jsonrpc":"2.0","method":"private/cancel","params":{"order_id":")"};
+    RequestTemplate editTemplate{
+        R"({"jsonrpc":"2.0","method":"private/edit","params":{"order_id":")"};
+
+public:
+    // Limit order; 'buy' selects private/buy, otherwise private/sell
+    std::string_view encodeLimitOrder(bool buy, std::string_view instrument, double price,
+                                      double amount, uint64_t id) {
+        RequestTemplate& t = buy ? buyTemplate : sellTemplate;
+        t.rewind();
+        t.appendString(instrument);
+        t.append(R"(","amount":)");
+        t.appendNumber(amount);
+        t.append(R"(,"price":)");
+        t.appendNumber(price);
+        t.append(R"(},"id":)");
+        t.appendInt(id);
+        t.append("}");
+        return t.view();
+    }
+
+    std::string_view encodeCancel(std::string_view orderId, uint64_t id) {
+        cancelTemplate.rewind();
+        cancelTemplate.appendString(orderId);
+        cancelTemplate.append(R"("},"id":)");
+        cancelTemplate.appendInt(id);
+        cancelTemplate.append("}");
+        return cancelTemplate.view();
+    }
+
+    std::string_view encodeEdit(std::string_view orderId, double price, double amount, uint64_t id) {
+        editTemplate.rewind();
+        editTemplate.appendString(orderId);
+        editTemplate.append(R"(","amount":)");
+        editTemplate.appendNumber(amount);
+        editTemplate.append(R"(,"price":)");
+        editTemplate.appendNumber(price);
+        editTemplate.append(R"(},"id":)");
+        editTemplate.appendInt(id);
+        editTemplate.append("}");
+        return editTemplate.view();
+    }
+};
+
+#endif // ORDER_TEMPLATES_H
@@ -1,119 +1,844 @@
 #ifndef PERFORMANCE_MONITOR_H
 #define PERFORMANCE_MONITOR_H
 
-#include <vector>
 #include <mutex>
 #include <iostream>
-#include <numeric>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+#include <nlohmann/json.hpp>
+#include "latency_histogram.h"
+#include "channel_registry.h"
+#include "alloc_tracker.h"
+#include "hw_counters.h"
+#include "string_format.h"
+
+// Named latency series, all recorded in nanoseconds
+enum class LatencyMetric : size_t {
+    RestRtt,        // REST request submit to response
+    WsRpcRtt,       // JSON-RPC over the WebSocket, send to reply
+    Parse,          // scanning one incoming WebSocket message
+    Dispatch,       // running the channel's handlers for one notification
+    BookApply,      // applying one book notification to the native book
+    TickToTrade     // last market data message received to order sent
+};
+constexpr size_t kLatencyMetricCount = 6;
+
+// Short name for exports
+inline const char* latencyMetricName(LatencyMetric metric) {
+    static const char* names[kLatencyMetricCount] = {
+        "rest_rtt", "ws_rpc_rtt", "parse", "dispatch", "book_apply", "tick_to_trade"
+    };
+    return names[static_cast<size_t>(metric)];
+}
+
+// Human-readable name for printStatistics
+inline const char* latencyMetricLabel(LatencyMetric metric) {
+    static const char* labels[kLatencyMetricCount] = {
+        "REST API Round Trip", "WebSocket RPC Round Trip", "Message Parse",
+        "Notification Dispatch", "Book Apply", "Tick to Trade"
+    };
+    return labels[static_cast<size_t>(metric)];
+}
+
+// Messages and orders per second over the last 'windowSeconds'
+struct ThroughputRate {
+    int windowSeconds = 0;
+    double messagesPerSecond = 0.0;
+    double ordersPerSecond = 0.0;
+};
+
+// Exchange timestamp to local receive time for one subscription channel
+struct FeedLatency {
+    std::string channel;
+    std::string instrument;
+    LatencyHistogram latencies; // microseconds, clock offset removed
+};
+
+// Point-in-time copy of the latency histograms; snapshots taken at
+// different times (or from different monitors) can be merged
+struct PerformanceSnapshot {
+    std::array<LatencyHistogram, kLatencyMetricCount> latencies; // nanoseconds
+    std::vector<FeedLatency> feeds;
+
+    uint64_t orderCount = 0;         // order requests sent
+    uint64_t marketDataCount = 0;    // subscription notifications received
+    double uptimeSeconds = 0.0;
+    std::vector<ThroughputRate> rates;
+
+    // Local clock minus exchange clock, and the round trip of the
+    // get_time sample it came from (-1 until the first sample)
+    long long clockOffsetMicros = 0;
+    long long clockRttMicros = -1;
+
+    const LatencyHistogram& latency(LatencyMetric metric) const {
+        return latencies[static_cast<size_t>(metric)];
+    }
+
+    void merge(const PerformanceSnapshot& other) {
+        for (size_t i = 0; i < kLatencyMetricCount; ++i) {
+            latencies[i].merge(other.latencies[i]);
+        }
+        orderCount += other.orderCount;
+        marketDataCount += other.marketDataCount;
+        uptimeSeconds = std::max(uptimeSeconds, other.uptimeSeconds);
+        for (const ThroughputRate& rate : other.rates) {
+            auto it = std::find_if(rates.begin(), rates.end(),
+                                   [&](const ThroughputRate& r) { return r.windowSeconds == rate.windowSeconds; });
+            if (it == rates.end()) {
+                rates.push_back(rate);
+            } else {
+                it->messagesPerSecond += rate.messagesPerSecond;
+                it->ordersPerSecond += rate.ordersPerSecond;
+            }
+        }
+        for (const FeedLatency& feed : other.feeds) {
+            auto it = std::find_if(feeds.begin(), feeds.end(),
+                                   [&](const FeedLatency& f) { return f.channel == feed.channel; });
+            if (it == feeds.end()) {
+                feeds.push_back(feed);
+            } else {
+                it->latencies.merge(feed.latencies);
+            }
+        }
+    }
+
+    // Feed latency with all channels of an instrument combined
+    std::map<std::string, LatencyHistogram> feedsByInstrument() const {
+        std::map<std::string, LatencyHistogram> result;
+        for (const FeedLatency& feed : feeds) {
+            result[feed.instrument].merge(feed.latencies);
+        }
+        return result;
+    }
+};
 
+// --------------------------------------------------------------------
+// PerformanceMonitor
+//   Latency recording never takes a lock. Each recording thread gets its
+//   own shard of histograms, written with plain stores. A low-priority
+//   aggregator thread merges all shards every aggregateInterval into one
+//   snapshot, which is what readers (printStatistics etc.) look at. The
+//   snapshot is immutable and shared by pointer, so a reader never copies it.
+// --------------------------------------------------------------------
 class PerformanceMonitor {
+public:
+    using FeedSeriesId = uint32_t;
+    // Feed latency series per shard, one per channel. The slots are fixed
+    // so recording never allocates an index; the first kMaxFeedSeries - 1
+    // channels get their own series and any further ones share the last,
+    // exported with channel and instrument "other".
+    static constexpr FeedSeriesId kMaxFeedSeries = 256;
+    static constexpr FeedSeriesId kOtherFeedSeries = kMaxFeedSeries - 1;
+    static constexpr FeedSeriesId kNoFeedSeries = 0xFFFFFFFFu;
+
 private:
-    std::vector<long long> restApiLatencies;      // For REST API latencies
-    std::vector<long long> websocketApiLatencies;  // For WebSocket API latencies
-    std::mutex latencyMutex;
+    // Written only by the thread that owns it
+    struct RecorderShard {
+        std::array<HistogramRecorder, kLatencyMetricCount> latencies;
+        std::atomic<uint64_t> orders{0};
+        std::atomic<uint64_t> marketDataMessages{0};
+        // Created by the owner the first time it records into a series
+        std::array<std::atomic<HistogramRecorder*>, kMaxFeedSeries> feeds{};
+        std::atomic<bool> retired{false}; // owning thread has exited
 
-    // Memory usage tracking
-    size_t peakMemoryUsage = 0;
+        ~RecorderShard() {
+            for (auto& feed : feeds) {
+                delete feed.load(std::memory_order_relaxed);
+            }
+        }
 
-    // Throughput tracking
-    std::atomic<long long> orderCount{0}; // Total orders placed
-    std::atomic<long long> marketDataCount{0}; // Total market data updates processed
+        // 'target.feeds' must already have an entry per registered series
+        void copyTo(PerformanceSnapshot& target) const {
+            for (size_t i = 0; i < kLatencyMetricCount; ++i) {
+                latencies[i].copyTo(target.latencies[i]);
+            }
+            target.orderCount += orders.load(std::memory_order_relaxed);
+            target.marketDataCount += marketDataMessages.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < target.feeds.size(); ++i) {
+                if (const HistogramRecorder* feed = feeds[i].load(std::memory_order_acquire)) {
+                    feed->copyTo(target.feeds[i].latencies);
+                }
+            }
+        }
+    };
+
+    // Each thread's shards, one per monitor it has recorded into. The last
+    // one used is cached so the common case is a single compare.
+    struct ThreadShards {
+        uint64_t lastMonitorId = 0;
+        RecorderShard* lastShard = nullptr;
+        std::vector<std::pair<uint64_t, std::shared_ptr<RecorderShard>>> owned;
+
+        ~ThreadShards() {
+            for (auto& entry : owned) {
+                entry.second->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    static ThreadShards& threadShards() {
+        static thread_local ThreadShards local;
+        return local;
+    }
+
+    static uint64_t nextMonitorId() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const uint64_t monitorId = nextMonitorId();
+
+    // Registration (once per thread) and aggregation only
+    std::mutex shardMutex;
+    std::vector<std::shared_ptr<RecorderShard>> shards;
+    PerformanceSnapshot retiredTotals; // folded in from threads that exited
+    std::vector<std::string> feedChannels;  // by FeedSeriesId
+
+    // Exchange clock offset from public/get_time round trips. The sample
+    // with the smallest round trip among the recent ones wins (NTP style).
+    struct ClockSample {
+        long long offsetMicros;
+        long long rttMicros;
+    };
+    static constexpr size_t kClockSamples = 16;
+    std::mutex clockMutex;
+    std::vector<ClockSample> clockSamples;
+    size_t nextClockSample = 0;
+    std::atomic<long long> clockOffsetMicros{0};
+    std::atomic<long long> clockRttMicros{-1};
+
+    // Latest merged view, published by aggregate(). Never modified once
+    // published: aggregate() swaps in a new one, readers share the pointer.
+    std::mutex snapshotMutex;
+    std::shared_ptr<const PerformanceSnapshot> aggregated = std::make_shared<const PerformanceSnapshot>();
+
+    std::chrono::milliseconds aggregateInterval{200};
+    std::mutex aggregatorMutex;
+    std::condition_variable aggregatorCondition;
+    bool stopping = false;
+    std::thread aggregatorThread;
+
+    // Optional perf_event counters, sampled by HardwareCounters::Scope
+    HardwareCounters hardwareCounters;
+
+    // Throughput tracking: counter totals as of each aggregation, kept
+    // long enough to cover the longest rate window (aggregator only)
+    struct CounterSample {
+        std::chrono::steady_clock::time_point at;
+        uint64_t orders;
+        uint64_t marketDataMessages;
+    };
+    static constexpr int kRateWindows[] = {1, 10, 60};
+    std::deque<CounterSample> counterHistory;
     
     std::chrono::steady_clock::time_point startTime;
 
+    // Negative values (clock adjustments) count as zero
+    static uint64_t toSample(long long microseconds) {
+        return microseconds > 0 ? static_cast<uint64_t>(microseconds) : 0;
+    }
+
+    // Single-writer counter increment: no lock prefix
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Caller holds shardMutex
+    void updateRates(PerformanceSnapshot& target) {
+        auto now = std::chrono::steady_clock::now();
+        counterHistory.push_back(CounterSample{now, target.orderCount, target.marketDataCount});
+        auto horizon = now - std::chrono::seconds(kRateWindows[2]) - aggregateInterval * 2;
+        while (counterHistory.size() > 1 && counterHistory.front().at < horizon) {
+            counterHistory.pop_front();
+        }
+
+        target.uptimeSeconds = std::chrono::duration<double>(now - startTime).count();
+        for (int window : kRateWindows) {
+            // Oldest sample still inside the window
+            auto since = now - std::chrono::seconds(window);
+            const CounterSample* base = &counterHistory.back();
+            for (const CounterSample& sample : counterHistory) {
+                if (sample.at >= since) {
+                    base = &sample;
+                    break;
+                }
+            }
+            ThroughputRate rate;
+            rate.windowSeconds = window;
+            double elapsed = std::chrono::duration<double>(now - base->at).count();
+            if (elapsed > 0.0) {
+                rate.messagesPerSecond = (target.marketDataCount - base->marketDataMessages) / elapsed;
+                rate.ordersPerSecond = (target.orderCount - base->orders) / elapsed;
+            }
+            target.rates.push_back(rate);
+        }
+    }
+
+    RecorderShard& localShard() {
+        ThreadShards& local = threadShards();
+        if (local.lastMonitorId == monitorId) {
+            return *local.lastShard;
+        }
+        return registerShard(local);
+    }
+
+    RecorderShard& registerShard(ThreadShards& local) {
+        RecorderShard* shard = nullptr;
+        for (auto& entry : local.owned) {
+            if (entry.first == monitorId) {
+                shard = entry.second.get();
+                break;
+            }
+        }
+        if (!shard) {
+            auto created = std::make_shared<RecorderShard>();
+            {
+                std::lock_guard<std::mutex> lock(shardMutex);
+                shards.push_back(created);
+            }
+            shard = created.get();
+            local.owned.emplace_back(monitorId, std::move(created));
+        }
+        local.lastMonitorId = monitorId;
+        local.lastShard = shard;
+        return *shard;
+    }
+
+    // Caller holds shardMutex: give 'target' an entry per registered series
+    void addFeedEntries(PerformanceSnapshot& target) const {
+        for (size_t i = target.feeds.size(); i < feedChannels.size(); ++i) {
+            FeedLatency feed;
+            feed.channel = feedChannels[i];
+            feed.instrument = i == kOtherFeedSeries ? feedChannels[i]
+                                                    : std::string(channelInstrument(feedChannels[i]));
+            target.feeds.push_back(std::move(feed));
+        }
+    }
+
+    void runAggregator() {
+#ifdef __linux__
+        // Only runs when a core would otherwise be idle
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+        std::unique_lock<std::mutex> lock(aggregatorMutex);
+        while (!stopping) {
+            aggregatorCondition.wait_for(lock, aggregateInterval, [this]() { return stopping; });
+            lock.unlock();
+            aggregate();
+            lock.lock();
+        }
+    }
+
 public:
+    PerformanceMonitor() : startTime(std::chrono::steady_clock::now()) {
+        aggregatorThread = std::thread([this]() { runAggregator(); });
+    }
+
+    PerformanceMonitor(const PerformanceMonitor&) = delete;
+    PerformanceMonitor& operator=(const PerformanceMonitor&) = delete;
+
+    ~PerformanceMonitor() {
+        {
+            std::lock_guard<std::mutex> lock(aggregatorMutex);
+            stopping = true;
+        }
+        aggregatorCondition.notify_one();
+        if (aggregatorThread.joinable()) {
+            aggregatorThread.join();
+        }
+    }
+
+    void recordLatency(LatencyMetric metric, uint64_t nanoseconds) {
+        localShard().latencies[static_cast<size_t>(metric)].record(nanoseconds);
+    }
+
     void recordRestApiLatency(long long microseconds) { // For REST API
-        std::lock_guard<std::mutex> lock(latencyMutex);
-        restApiLatencies.push_back(microseconds);
+        recordLatency(LatencyMetric::RestRtt, toSample(microseconds) * 1000);
     }
 
     void recordWebSocketApiLatency(long long microseconds) { // For WebSocket API
-        std::lock_guard<std::mutex> lock(latencyMutex);
-        websocketApiLatencies.push_back(microseconds);
+        recordLatency(LatencyMetric::WsRpcRtt, toSample(microseconds) * 1000);
+    }
+
+    // One order request (place, edit or cancel) sent
+    void recordOrder() {
+        bump(localShard().orders);
     }
 
-    void recordMarketDataLatency(long long microseconds) { // Add this method
-        std::lock_guard<std::mutex> lock(latencyMutex);
-        websocketApiLatencies.push_back(microseconds); // Assuming you want to track it here
+    // One subscription notification received
+    void recordMarketDataMessage() {
+        bump(localShard().marketDataMessages);
     }
 
-    void checkMemoryUsage() {
-        // This is platform-specific and simplified
-        // For a real implementation, use platform-specific APIs
-        #ifdef _WIN32
-        // Windows implementation
-        PROCESS_MEMORY_COUNTERS pmc;
-        if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
-            size_t currentUsage = pmc.WorkingSetSize;
-            peakMemoryUsage = std::max(peakMemoryUsage, currentUsage);
+    // Start sampling cycles, instructions and cache/branch misses around
+    // hot operations; false if the counters cannot be opened
+    bool enableHardwareCounters() {
+        return hardwareCounters.enable();
+    }
+
+    HardwareCounters& hardware() {
+        return hardwareCounters;
+    }
+
+    // Merge every shard into the published snapshot. Runs periodically on
+    // the aggregator thread; call directly to force an up-to-date view.
+    void aggregate() {
+        std::shared_ptr<PerformanceSnapshot> merged;
+        {
+            std::lock_guard<std::mutex> lock(shardMutex);
+            addFeedEntries(retiredTotals);
+            for (auto it = shards.begin(); it != shards.end();) {
+                if ((*it)->retired.load(std::memory_order_acquire)) {
+                    (*it)->copyTo(retiredTotals);
+                    it = shards.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            merged = std::make_shared<PerformanceSnapshot>(retiredTotals);
+            for (const auto& shard : shards) {
+                shard->copyTo(*merged);
+            }
+            updateRates(*merged);
         }
-        #else
-        // Linux implementation (simplified)
+        merged->clockOffsetMicros = clockOffsetMicros.load(std::memory_order_relaxed);
+        merged->clockRttMicros = clockRttMicros.load(std::memory_order_relaxed);
+        std::shared_ptr<const PerformanceSnapshot> previous = std::move(merged);
+        {
+            std::lock_guard<std::mutex> lock(snapshotMutex);
+            aggregated.swap(previous);
+        }
+        // The old snapshot (if no reader still holds it) is freed here,
+        // outside the lock
+    }
+
+    // Register a subscription channel for feed latency; returns the same
+    // ID for the same channel. Call at subscribe time, not per message.
+    FeedSeriesId registerFeedSeries(const std::string& channel) {
+        std::lock_guard<std::mutex> lock(shardMutex);
+        for (size_t i = 0; i < std::min<size_t>(feedChannels.size(), kOtherFeedSeries); ++i) {
+            if (feedChannels[i] == channel) {
+                return static_cast<FeedSeriesId>(i);
+            }
+        }
+        if (feedChannels.size() >= kOtherFeedSeries) {
+            if (feedChannels.size() == kOtherFeedSeries) {
+                std::cerr << "Feed latency: more than " << kOtherFeedSeries << " channels; " << channel
+                          << " and later ones are recorded as \"other\"" << std::endl;
+                feedChannels.push_back("other");
+            }
+            return kOtherFeedSeries;
+        }
+        feedChannels.push_back(channel);
+        return static_cast<FeedSeriesId>(feedChannels.size() - 1);
+    }
+
+    // Exchange timestamp (ms since epoch) to local receive time (wall
+    // clock, us since epoch), corrected by the estimated clock offset
+    void recordFeedLatency(FeedSeriesId series, int64_t exchangeTimestampMs, int64_t receivedAtMicros) {
+        if (series >= kMaxFeedSeries || exchangeTimestampMs <= 0) {
+            return;
+        }
+        long long latency = receivedAtMicros - exchangeTimestampMs * 1000
+                            - clockOffsetMicros.load(std::memory_order_relaxed);
+        RecorderShard& shard = localShard();
+        HistogramRecorder* feed = shard.feeds[series].load(std::memory_order_relaxed);
+        if (!feed) {
+            feed = new HistogramRecorder();
+            shard.feeds[series].store(feed, std::memory_order_release);
+        }
+        feed->record(toSample(latency));
+    }
+
+    // One public/get_time round trip: local wall clock (us) just before
+    // sending and on receipt, and the exchange time (ms) it returned
+    void recordClockSample(int64_t sentAtMicros, int64_t receivedAtMicros, int64_t exchangeTimeMs) {
+        ClockSample sample;
+        sample.rttMicros = receivedAtMicros - sentAtMicros;
+        // Assume the exchange read its clock halfway through the round trip
+        sample.offsetMicros = sentAtMicros + sample.rttMicros / 2 - exchangeTimeMs * 1000;
+        if (sample.rttMicros < 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(clockMutex);
+        if (clockSamples.size() < kClockSamples) {
+            clockSamples.push_back(sample);
+        } else {
+            clockSamples[nextClockSample] = sample;
+        }
+        nextClockSample = (nextClockSample + 1) % kClockSamples;
+
+        const ClockSample* best = &clockSamples.front();
+        for (const ClockSample& s : clockSamples) {
+            if (s.rttMicros < best->rttMicros) {
+                best = &s;
+            }
+        }
+        clockOffsetMicros.store(best->offsetMicros, std::memory_order_relaxed);
+        clockRttMicros.store(best->rttMicros, std::memory_order_relaxed);
+    }
+
+    // Latest aggregated view (at most aggregateInterval old). Shared, not
+    // copied: holding it keeps that snapshot alive past later aggregations.
+    std::shared_ptr<const PerformanceSnapshot> snapshot() {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        return aggregated;
+    }
+
+    void printStatistics() {
+        aggregate();
+        std::shared_ptr<const PerformanceSnapshot> published = snapshot();
+        const PerformanceSnapshot& stats = *published;
+
+        std::cout << "Uptime: " << stats.uptimeSeconds << " s\n";
+        std::cout << "Orders sent: " << stats.orderCount
+                  << ", market data messages: " << stats.marketDataCount << "\n";
+        for (const ThroughputRate& rate : stats.rates) {
+            std::cout << "  Last " << rate.windowSeconds << " s: "
+                      << rate.messagesPerSecond << " msgs/s, "
+                      << rate.ordersPerSecond << " orders/s\n";
+        }
+        
+        for (size_t i = 0; i < kLatencyMetricCount; ++i) {
+            if (stats.latencies[i].count() > 0) {
+                std::cout << latencyMetricLabel(static_cast<LatencyMetric>(i)) << " Latency (microseconds):\n";
+                printLatencyStats(stats.latencies[i], 1000.0);
+            }
+        }
+
+        if (!stats.feeds.empty()) {
+            std::cout << "Feed Latency, exchange timestamp to receive (microseconds):\n";
+            if (stats.clockRttMicros >= 0) {
+                std::cout << "  Clock offset vs exchange: " << stats.clockOffsetMicros
+                          << " (get_time RTT " << stats.clockRttMicros
+                          << ", exchange timestamps have 1 ms resolution)\n";
+            } else {
+                std::cout << "  Clock offset vs exchange: not yet estimated\n";
+            }
+            for (const auto& entry : stats.feedsByInstrument()) {
+                if (entry.second.count() > 0) {
+                    std::cout << "  " << (entry.first.empty() ? "(no instrument)" : entry.first) << ":\n";
+                    printLatencyStats(entry.second, 1.0);
+                }
+            }
+            for (const FeedLatency& feed : stats.feeds) {
+                if (feed.latencies.count() > 0) {
+                    std::cout << "  " << feed.channel << ": p50 " << feed.latencies.percentile(50.0)
+                              << ", p99 " << feed.latencies.percentile(99.0)
+                              << " (" << feed.latencies.count() << " samples)\n";
+                }
+            }
+        }
+
+        std::cout << "Peak Memory Usage: " << (peakResidentMemory() / 1024.0 / 1024.0) << " MB\n";
+        printHeapStats();
+        printHardwareCounters();
+    }
+
+
+private:
+    // Per-subsystem heap accounting (builds with DERIBIT_TRACK_ALLOCATIONS)
+    void printHeapStats() {
+        if (!AllocTracker::enabled()) {
+            return;
+        }
+        std::cout << "Heap: " << AllocTracker::liveBytes() << " bytes live, peak "
+                  << AllocTracker::peakLiveBytes() << "\n";
+        for (size_t i = 0; i < kAllocTagCount; ++i) {
+            AllocStats heap = AllocTracker::stats(static_cast<AllocTag>(i));
+            std::cout << "  " << allocTagName(static_cast<AllocTag>(i)) << ": "
+                      << heap.allocations << " allocations, " << heap.bytesAllocated << " bytes, "
+                      << heap.liveBytes << " live";
+            if (heap.hotPathAllocations > 0) {
+                std::cout << ", " << heap.hotPathAllocations << " ON HOT PATH ("
+                          << heap.hotPathBytes << " bytes)";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    void printHardwareCounters() {
+        if (!hardwareCounters.enabled()) {
+            return;
+        }
+        std::cout << "Hardware Counters (user space, per operation):\n";
+        for (size_t i = 0; i < kHwOpCount; ++i) {
+            HwOpStats hw = hardwareCounters.stats(static_cast<HwOp>(i));
+            if (hw.samples == 0) {
+                continue;
+            }
+            std::cout << "  " << hwOpName(static_cast<HwOp>(i)) << " (" << hw.samples << " samples): "
+                      << "IPC " << hw.ipc()
+                      << ", cycles " << hw.perSample(hw.cycles)
+                      << ", instructions " << hw.perSample(hw.instructions)
+                      << ", cache misses " << hw.perSample(hw.cacheMisses)
+                      << ", branch misses " << hw.perSample(hw.branchMisses) << "\n";
+        }
+    }
+
+    // 'scale' converts recorded units to printed ones (1000 for ns -> us)
+    void printLatencyStats(const LatencyHistogram& latencies, double scale) {
+        if (latencies.count() == 0) return;
+        
+        std::cout << "  Samples: " << latencies.count() << "\n";
+        std::cout << "  Min: " << latencies.min() / scale << "\n";
+        std::cout << "  Max: " << latencies.max() / scale << "\n";
+        std::cout << "  Mean: " << latencies.mean() / scale << "\n";
+        std::cout << "  Median: " << latencies.percentile(50.0) / scale << "\n";
+        std::cout << "  95th Percentile: " << latencies.percentile(95.0) / scale << "\n";
+        std::cout << "  99th Percentile: " << latencies.percentile(99.0) / scale << "\n";
+        std::cout << "  99.9th Percentile: " << latencies.percentile(99.9) / scale << "\n";
+    }
+
+    static nlohmann::json histogramJson(const LatencyHistogram& latencies) {
+        return {
+            {"count", latencies.count()},
+            {"min", latencies.min()},
+            {"max", latencies.max()},
+            {"mean", latencies.mean()},
+            {"p50", latencies.percentile(50.0)},
+            {"p90", latencies.percentile(90.0)},
+            {"p99", latencies.percentile(99.0)},
+            {"p999", latencies.percentile(99.9)}
+        };
+    }
+
+public:
+    // Machine-readable form of the latest aggregated snapshot
+    std::string exportJson() {
+        std::shared_ptr<const PerformanceSnapshot> published = snapshot();
+        const PerformanceSnapshot& stats = *published;
+        nlohmann::json out;
+        out["uptime_seconds"] = stats.uptimeSeconds;
+        out["counters"] = {
+            {"orders", stats.orderCount},
+            {"market_data_messages", stats.marketDataCount}
+        };
+        out["rates"] = nlohmann::json::array();
+        for (const ThroughputRate& rate : stats.rates) {
+            out["rates"].push_back({
+                {"window_seconds", rate.windowSeconds},
+                {"messages_per_second", rate.messagesPerSecond},
+                {"orders_per_second", rate.ordersPerSecond}
+            });
+        }
+        out["latency_ns"] = nlohmann::json::object();
+        for (size_t i = 0; i < kLatencyMetricCount; ++i) {
+            out["latency_ns"][latencyMetricName(static_cast<LatencyMetric>(i))] = histogramJson(stats.latencies[i]);
+        }
+        nlohmann::json feeds = {
+            {"clock_offset_us", stats.clockOffsetMicros},
+            {"clock_rtt_us", stats.clockRttMicros},
+            {"by_channel", nlohmann::json::object()},
+            {"by_instrument", nlohmann::json::object()}
+        };
+        for (const FeedLatency& feed : stats.feeds) {
+            feeds["by_channel"][feed.channel] = histogramJson(feed.latencies);
+        }
+        for (const auto& entry : stats.feedsByInstrument()) {
+            feeds["by_instrument"][entry.first] = histogramJson(entry.second);
+        }
+        out["feed_latency_us"] = feeds;
+        out["peak_memory_bytes"] = peakResidentMemory();
+        if (AllocTracker::enabled()) {
+            nlohmann::json heap = {
+                {"live_bytes", AllocTracker::liveBytes()},
+                {"peak_live_bytes", AllocTracker::peakLiveBytes()},
+                {"by_subsystem", nlohmann::json::object()}
+            };
+            for (size_t i = 0; i < kAllocTagCount; ++i) {
+                AllocStats stats = AllocTracker::stats(static_cast<AllocTag>(i));
+                heap["by_subsystem"][allocTagName(static_cast<AllocTag>(i))] = {
+                    {"allocations", stats.allocations},
+                    {"frees", stats.frees},
+                    {"bytes_allocated", stats.bytesAllocated},
+                    {"live_bytes", stats.liveBytes},
+                    {"hot_path_allocations", stats.hotPathAllocations},
+                    {"hot_path_bytes", stats.hotPathBytes}
+                };
+            }
+            out["heap"] = heap;
+        }
+        if (hardwareCounters.enabled()) {
+            nlohmann::json hardware = nlohmann::json::object();
+            for (size_t i = 0; i < kHwOpCount; ++i) {
+                HwOpStats hw = hardwareCounters.stats(static_cast<HwOp>(i));
+                hardware[hwOpName(static_cast<HwOp>(i))] = {
+                    {"samples", hw.samples},
+                    {"ipc", hw.ipc()},
+                    {"cycles_per_op", hw.perSample(hw.cycles)},
+                    {"instructions_per_op", hw.perSample(hw.instructions)},
+                    {"cache_misses_per_op", hw.perSample(hw.cacheMisses)},
+                    {"branch_misses_per_op", hw.perSample(hw.branchMisses)}
+                };
+            }
+            out["hardware_counters"] = hardware;
+        }
+        return out.dump(2);
+    }
+
+    // Peak resident set size in bytes, as tracked by the kernel (VmHWM),
+    // so nothing has to poll for it (0 if unavailable)
+    static size_t peakResidentMemory() {
+        size_t peak = 0;
+        #ifdef __linux__
         FILE* file = fopen("/proc/self/status", "r");
         if (file) {
             char line[128];
-            while (fgets(line, 128, file) != NULL) {
-                if (strncmp(line, "VmRSS:", 6) == 0) {
-                    size_t currentUsage = 0;
-                    sscanf(line + 6, "%zu", &currentUsage);
-                    currentUsage *= 1024; // Convert from KB to bytes
-                    peakMemoryUsage = std::max(peakMemoryUsage, currentUsage);
+            while (fgets(line, sizeof(line), file) != NULL) {
+                if (strncmp(line, "VmHWM:", 6) == 0) {
+                    sscanf(line + 6, "%zu", &peak);
+                    peak *= 1024; // kB to bytes
                     break;
                 }
             }
             fclose(file);
         }
         #endif
+        return peak;
     }
 
-    void printStatistics() {
-        std::lock_guard<std::mutex> lock(latencyMutex);
-        
-        if (!restApiLatencies.empty()) {
-            std::cout << "REST API Latency (microseconds):\n";
-            printLatencyStats(restApiLatencies);
+    // Current resident set size in bytes (0 if unavailable)
+    static size_t currentResidentMemory() {
+        #ifdef __linux__
+        size_t pages = 0;
+        size_t residentPages = 0;
+        FILE* file = fopen("/proc/self/statm", "r");
+        if (file) {
+            if (fscanf(file, "%zu %zu", &pages, &residentPages) != 2) {
+                residentPages = 0;
+            }
+            fclose(file);
         }
-        
-        if (!websocketApiLatencies.empty()) {
-            std::cout << "WebSocket API Latency (microseconds):\n";
-            printLatencyStats(websocketApiLatencies);
+        return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        #else
+        return 0;
+        #endif
+    }
+
+    // Prometheus text exposition (format 0.0.4) of the latest aggregated
+    // snapshot. Only reads the published snapshot, never the shards.
+    std::string exportPrometheus() {
+        std::shared_ptr<const PerformanceSnapshot> published = snapshot();
+        const PerformanceSnapshot& stats = *published;
+        std::string out;
+        out.reserve(8192);
+        // Quantiles plus _sum and _count; 'scale' converts to seconds
+        auto summary = [&](const char* name, const std::string& labels, const LatencyHistogram& h, double scale) {
+            static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+            for (double q : quantiles) {
+                appendFormat(out, "%s{%s,quantile=\"%g\"} %.9g\n", name, labels.c_str(), q, h.percentile(q * 100.0) * scale);
+            }
+            appendFormat(out, "%s_sum{%s} %.9g\n", name, labels.c_str(), h.mean() * h.count() * scale);
+            appendFormat(out, "%s_count{%s} %llu\n", name, labels.c_str(), static_cast<unsigned long long>(h.count()));
+        };
+
+        out += "# HELP deribit_latency_seconds Latency of internal operations and API round trips.\n";
+        out += "# TYPE deribit_latency_seconds summary\n";
+        for (size_t i = 0; i < kLatencyMetricCount; ++i) {
+            std::string labels = std::string("series=\"") + latencyMetricName(static_cast<LatencyMetric>(i)) + "\"";
+            summary("deribit_latency_seconds", labels, stats.latencies[i], 1e-9);
         }
 
-        std::cout << "Peak Memory Usage: " << (peakMemoryUsage / 1024.0 / 1024.0) << " MB\n";
-    }
+        out += "# HELP deribit_feed_latency_seconds Exchange timestamp to local receive, clock offset removed.\n";
+        out += "# TYPE deribit_feed_latency_seconds summary\n";
+        for (const FeedLatency& feed : stats.feeds) {
+            std::string labels = "channel=\"" + feed.channel + "\",instrument=\"" + feed.instrument + "\"";
+            summary("deribit_feed_latency_seconds", labels, feed.latencies, 1e-6);
+        }
 
+        out += "# HELP deribit_clock_offset_seconds Local clock minus exchange clock.\n";
+        out += "# TYPE deribit_clock_offset_seconds gauge\n";
+        appendFormat(out, "deribit_clock_offset_seconds %.9g\n", stats.clockOffsetMicros * 1e-6);
 
-private:
-    void printLatencyStats(const std::vector<long long>& latencies) {
-        if (latencies.empty()) return;
-        
-        long long sum = std::accumulate(latencies.begin(), latencies.end(), 0LL);
-        double mean = sum / static_cast<double>(latencies.size());
-        
-        std::vector<long long> sorted = latencies;
-        std::sort(sorted.begin(), sorted.end());
-        
-        long long min = sorted.front();
-        long long max = sorted.back();
-        long long median = sorted[sorted.size() / 2];
-        
-        // Calculate 95th percentile
-        size_t p95_index = static_cast<size_t>(sorted.size() * 0.95);
-        long long p95 = sorted[p95_index];
-        
-        // Calculate 99th percentile
-        size_t p99_index = static_cast<size_t>(sorted.size() * 0.99);
-        long long p99 = sorted[p99_index];
-        
-        std::cout << "  Samples: " << latencies.size() << "\n";
-        std::cout << "  Min: " << min << "\n";
-        std::cout << "  Max: " << max << "\n";
-        std::cout << "  Mean: " << mean << "\n";
-        std::cout << "  Median: " << median << "\n";
-        std::cout << "  95th Percentile: " << p95 << "\n";
-        std::cout << "  99th Percentile: " << p99 << "\n";
+        out += "# HELP deribit_orders_total Order requests sent.\n";
+        out += "# TYPE deribit_orders_total counter\n";
+        appendFormat(out, "deribit_orders_total %llu\n", static_cast<unsigned long long>(stats.orderCount));
+        out += "# HELP deribit_market_data_messages_total Subscription notifications received.\n";
+        out += "# TYPE deribit_market_data_messages_total counter\n";
+        appendFormat(out, "deribit_market_data_messages_total %llu\n", static_cast<unsigned long long>(stats.marketDataCount));
+
+        out += "# HELP deribit_messages_per_second Market data message rate over a rolling window.\n";
+        out += "# TYPE deribit_messages_per_second gauge\n";
+        for (const ThroughputRate& rate : stats.rates) {
+            appendFormat(out, "deribit_messages_per_second{window=\"%ds\"} %.6g\n", rate.windowSeconds, rate.messagesPerSecond);
+        }
+        out += "# HELP deribit_orders_per_second Order rate over a rolling window.\n";
+        out += "# TYPE deribit_orders_per_second gauge\n";
+        for (const ThroughputRate& rate : stats.rates) {
+            appendFormat(out, "deribit_orders_per_second{window=\"%ds\"} %.6g\n", rate.windowSeconds, rate.ordersPerSecond);
+        }
+
+        out += "# HELP deribit_uptime_seconds Time since the monitor started.\n";
+        out += "# TYPE deribit_uptime_seconds gauge\n";
+        appendFormat(out, "deribit_uptime_seconds %.3f\n", stats.uptimeSeconds);
+
+        out += "# HELP process_resident_memory_bytes Resident memory size in bytes.\n";
+        out += "# TYPE process_resident_memory_bytes gauge\n";
+        appendFormat(out, "process_resident_memory_bytes %zu\n", currentResidentMemory());
+
+        if (AllocTracker::enabled()) {
+            out += "# HELP deribit_heap_allocations_total Heap allocations by subsystem.\n";
+            out += "# TYPE deribit_heap_allocations_total counter\n";
+            for (size_t i = 0; i < kAllocTagCount; ++i) {
+                appendFormat(out, "deribit_heap_allocations_total{subsystem=\"%s\"} %llu\n", allocTagName(static_cast<AllocTag>(i)),
+                       static_cast<unsigned long long>(AllocTracker::stats(static_cast<AllocTag>(i)).allocations));
+            }
+            out += "# HELP deribit_heap_live_bytes Heap bytes allocated by a subsystem and not yet freed.\n";
+            out += "# TYPE deribit_heap_live_bytes gauge\n";
+            for (size_t i = 0; i < kAllocTagCount; ++i) {
+                appendFormat(out, "deribit_heap_live_bytes{subsystem=\"%s\"} %lld\n", allocTagName(static_cast<AllocTag>(i)),
+                       static_cast<long long>(AllocTracker::stats(static_cast<AllocTag>(i)).liveBytes));
+            }
+            out += "# HELP deribit_hot_path_allocations_total Heap allocations made on a marked hot path.\n";
+            out += "# TYPE deribit_hot_path_allocations_total counter\n";
+            for (size_t i = 0; i < kAllocTagCount; ++i) {
+                appendFormat(out, "deribit_hot_path_allocations_total{subsystem=\"%s\"} %llu\n", allocTagName(static_cast<AllocTag>(i)),
+                       static_cast<unsigned long long>(AllocTracker::stats(static_cast<AllocTag>(i)).hotPathAllocations));
+            }
+        }
+
+        if (hardwareCounters.enabled()) {
+            // Raw totals; IPC and per-operation rates are ratios of these
+            static const char* const events[] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+            out += "# HELP deribit_hw_operations_total Operations sampled with hardware counters.\n";
+            out += "# TYPE deribit_hw_operations_total counter\n";
+            for (size_t i = 0; i < kHwOpCount; ++i) {
+                appendFormat(out, "deribit_hw_operations_total{op=\"%s\"} %llu\n", hwOpName(static_cast<HwOp>(i)),
+                       static_cast<unsigned long long>(hardwareCounters.stats(static_cast<HwOp>(i)).samples));
+            }
+            out += "# HELP deribit_hw_events_total User-space hardware events counted during sampled operations.\n";
+            out += "# TYPE deribit_hw_events_total counter\n";
+            for (size_t i = 0; i < kHwOpCount; ++i) {
+                HwOpStats hw = hardwareCounters.stats(static_cast<HwOp>(i));
+                const uint64_t values[] = {hw.cycles, hw.instructions, hw.cacheMisses, hw.branchMisses};
+                for (size_t e = 0; e < 4; ++e) {
+                    appendFormat(out, "deribit_hw_events_total{op=\"%s\",event=\"%s\"} %llu\n", hwOpName(static_cast<HwOp>(i)),
+                           events[e], static_cast<unsigned long long>(values[e]));
+                }
+            }
+        }
+        return out;
     }
 };
 
-#endif // PERFORMANCE_MONITOR_H 
\ No newline at end of file
+#endif // PERFORMANCE_MONITOR_H
\ No newline at end of file
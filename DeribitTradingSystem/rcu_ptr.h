@@ -0,0 +1,97 @@
+#ifndef RCU_PTR_H
+#define RCU_PTR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// --------------------------------------------------------------------
+// RcuPtr: read-mostly object with wait-free reads and copy-on-write updates
+//   - One reader thread (e.g. the WebSocket IO thread) calls read().
+//     That is two stores to its own epoch counter and one pointer load:
+//     no lock, no retry loop, no reference counting.
+//   - Writers (any thread) copy the current object, modify the copy and
+//     swap it in. The old copy is retired, and freed by a later writer
+//     once the reader has been seen outside the read section it may
+//     have been in during the swap. Writers never wait for the reader.
+//   read() is not reentrant; calling update() from inside read() is fine.
+// --------------------------------------------------------------------
+template <typename T>
+class RcuPtr {
+private:
+    struct Retired {
+        const T* object;
+        uint64_t readerEpoch; // reader epoch observed right after the swap
+    };
+
+    std::atomic<const T*> current;
+
+    // Odd while the reader is inside read()
+    alignas(64) mutable std::atomic<uint64_t> readerEpoch{0};
+
+    alignas(64) std::mutex writerMutex;
+    std::vector<Retired> retired;
+
+    // Caller holds writerMutex
+    void reclaim() {
+        uint64_t epoch = readerEpoch.load(std::memory_order_seq_cst);
+        size_t kept = 0;
+        for (const Retired& r : retired) {
+            // Safe if the reader was outside read() at swap time, or has
+            // since left the section it was in
+            bool safe = (r.readerEpoch & 1) == 0 || epoch != r.readerEpoch;
+            if (safe) {
+                delete r.object;
+            } else {
+                retired[kept++] = r;
+            }
+        }
+        retired.resize(kept);
+    }
+
+public:
+    explicit RcuPtr(std::unique_ptr<T> initial = std::make_unique<T>())
+        : current(initial.release()) {}
+
+    RcuPtr(const RcuPtr&) = delete;
+    RcuPtr& operator=(const RcuPtr&) = delete;
+
+    // Assumes the reader thread has stopped
+    ~RcuPtr() {
+        for (const Retired& r : retired) {
+            delete r.object;
+        }
+        delete current.load();
+    }
+
+    // Reader thread only: runs f(const T&) against a stable snapshot
+    template <typename F>
+    decltype(auto) read(F&& f) const {
+        struct Section {
+            std::atomic<uint64_t>& epoch;
+            explicit Section(std::atomic<uint64_t>& e) : epoch(e) {
+                epoch.store(epoch.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+            }
+            ~Section() {
+                epoch.store(epoch.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+        } section(readerEpoch);
+
+        return f(*current.load(std::memory_order_seq_cst));
+    }
+
+    // Any thread: applies f(T&) to a copy and publishes it
+    template <typename F>
+    void update(F&& f) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        auto next = std::make_unique<T>(*current.load(std::memory_order_relaxed));
+        f(*next);
+        const T* old = current.exchange(next.release(), std::memory_order_seq_cst);
+        retired.push_back(Retired{old, readerEpoch.load(std::memory_order_seq_cst)});
+        reclaim();
+    }
+};
+
+#endif // RCU_PTR_H
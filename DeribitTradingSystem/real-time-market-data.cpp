@@ -4,33 +4,42 @@
 #include <iostream>
 #include <string>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <unordered_map>
-#include <mutex>
-#include <condition_variable>
 #include <vector>
+#include "spsc_ring.h"
 
 using json = nlohmann::json;
 
 using websocketpp::connection_hdl;
 typedef websocketpp::client<websocketpp::config::asio_client> client;
 
-// Mutex for thread-safe data access
-std::mutex data_mutex;
-std::condition_variable data_cv;
-std::unordered_map<std::string, json> orderbook_data;
+// Raw frames handed from the WebSocket IO thread to the printer thread.
+// Slot buffers are reserved up front for a typical book update; a larger
+// frame grows its slot once and the slot keeps that capacity.
+struct MarketDataMessage {
+    std::string payload;
+};
 
-void on_message(websocketpp::connection_hdl hdl, client::message_ptr msg) {
-    std::lock_guard<std::mutex> lock(data_mutex);
+constexpr size_t kMarketDataRingSize = 4096;
+constexpr size_t kMarketDataSlotReserve = 2 * 1024;
+
+SpscRing<MarketDataMessage, kMarketDataRingSize> market_data_ring;
 
-    // Parse the incoming message
-    json message = json::parse(msg->get_payload());
+// When true the consumer spins on the ring instead of backing off
+// (lowest latency, but keeps one core at 100%)
+std::atomic<bool> busy_spin_consumer{false};
 
-    // Check if it contains order book updates
-    if (message.contains("params") && message["params"].contains("channel")) {
-        std::string channel = message["params"]["channel"];
-        orderbook_data[channel] = message["params"]["data"];
-        data_cv.notify_all();
+void on_message(websocketpp::connection_hdl hdl, client::message_ptr msg) {
+    // Never wait on the consumer: if the ring is full the message is
+    // dropped and counted as an overflow
+    MarketDataMessage* slot = market_data_ring.claim();
+    if (slot == nullptr) {
+        return;
     }
+    slot->payload.assign(msg->get_payload());
+    market_data_ring.publish();
 }
 
 void subscribe_to_channels(client &c, websocketpp::connection_hdl hdl) {
@@ -96,21 +105,69 @@ void websocket_thread() {
 }
 
 void stream_orderbook_updates() {
+    uint64_t reported_overflows = 0;
+    unsigned idle_polls = 0;
+    // Latest update per channel since the last print; printing is far
+    // slower than the feed, so older updates are superseded, not printed
+    std::unordered_map<std::string, json> latest;
+    size_t drained = 0;
+
     while (true) {
-        std::unique_lock<std::mutex> lock(data_mutex);
-        data_cv.wait(lock, [] { return !orderbook_data.empty(); });
+        MarketDataMessage* slot = market_data_ring.front();
+        if (!latest.empty() && (slot == nullptr || drained >= kMarketDataRingSize)) {
+            // Caught up with the ring (or a ring's worth behind a feed
+            // that never pauses): print what is current, once
+            for (const auto &[channel, data] : latest) {
+                std::cout << "Channel: " << channel << std::endl;
+                std::cout << "Data: " << data.dump(4) << std::endl;
+            }
+            latest.clear();
+            drained = 0;
+            continue;
+        }
+        if (slot == nullptr) {
+            // Nothing queued: spin, then yield, then sleep briefly
+            if (busy_spin_consumer.load(std::memory_order_relaxed) || ++idle_polls < 1000) {
+                cpuRelax();
+            } else if (idle_polls < 2000) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            continue;
+        }
+        idle_polls = 0;
+
+        // Parse straight out of the slot, then hand it back
+        json message;
+        try {
+            message = json::parse(slot->payload);
+        } catch (const std::exception &e) {
+            std::cerr << "Error parsing market data message: " << e.what() << std::endl;
+        }
+        market_data_ring.pop();
+        ++drained;
 
-        for (const auto &[channel, data] : orderbook_data) {
-            std::cout << "Channel: " << channel << std::endl;
-            std::cout << "Data: " << data.dump(4) << std::endl;
+        // Check if it contains order book updates
+        if (message.contains("params") && message["params"].contains("channel")) {
+            latest[message["params"]["channel"].get<std::string>()] = std::move(message["params"]["data"]);
         }
 
-        // Clear the processed data to avoid duplicate printing
-        orderbook_data.clear();
+        uint64_t overflows = market_data_ring.overflows();
+        if (overflows != reported_overflows) {
+            std::cerr << "Market data ring full: dropped " << (overflows - reported_overflows)
+                      << " messages (" << overflows << " total)" << std::endl;
+            reported_overflows = overflows;
+        }
     }
 }
 
-void start_market_data_service() {
+void start_market_data_service(bool busy_spin = false) {
+    busy_spin_consumer = busy_spin;
+    market_data_ring.forEachSlot([](MarketDataMessage& slot) {
+        slot.payload.reserve(kMarketDataSlotReserve);
+    });
+
     std::thread ws_thread(websocket_thread);
     std::thread stream_thread(stream_orderbook_updates);
     
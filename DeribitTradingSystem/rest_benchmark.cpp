@@ -0,0 +1,172 @@
+// --------------------------------------------------------------------
+// REST transport benchmark
+//   Compares request latency (p50/p99) and throughput of:
+//     blocking - one easy handle, curl_easy_perform per request
+//                (the original DeribitAPIClient::sendRequest path)
+//     http1    - AsyncRestClient over HTTP/1.1 keep-alive connections
+//     http2    - AsyncRestClient multiplexing over one HTTP/2 connection
+//
+//   Build:  g++ -std=c++17 -O2 rest_benchmark.cpp -o rest_benchmark -lcurl -pthread
+//   Run:    ./rest_benchmark <url> [requests] [concurrency] [modes...]
+//
+//   Use a local stand-in server so the numbers reflect the client, not
+//   the internet. For cleartext h2c (http:// URLs) the http2 mode uses
+//   prior knowledge, so the server must speak h2c without an upgrade.
+// --------------------------------------------------------------------
+#include <curl/curl.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "async_rest_client.h"
+
+using namespace std::chrono;
+
+struct BenchmarkResult {
+    std::vector<long long> latencies; // microseconds
+    long long wallMicros = 0;
+    size_t failures = 0;
+};
+
+static const char* kRequestBody =
+    R"({"jsonrpc":"2.0","id":1,"method":"public/get_time","params":{}})";
+
+static size_t discardBody(char* ptr, size_t size, size_t nmemb, std::string* data) {
+    data->append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+// The pre-existing path: one handle, one request at a time
+BenchmarkResult runBlocking(const std::string& url, size_t requests) {
+    BenchmarkResult result;
+    CURL* easy = curl_easy_init();
+    curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+    std::string body;
+
+    auto wallStart = steady_clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        body.clear();
+        curl_easy_reset(easy);
+        curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(easy, CURLOPT_POST, 1L);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, kRequestBody);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, discardBody);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, &body);
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, 5000L);
+
+        auto start = steady_clock::now();
+        CURLcode res = curl_easy_perform(easy);
+        auto end = steady_clock::now();
+        if (res != CURLE_OK) {
+            ++result.failures;
+            continue;
+        }
+        result.latencies.push_back(duration_cast<microseconds>(end - start).count());
+    }
+    result.wallMicros = duration_cast<microseconds>(steady_clock::now() - wallStart).count();
+
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(easy);
+    return result;
+}
+
+// AsyncRestClient with up to 'concurrency' requests in flight
+BenchmarkResult runAsync(const std::string& url, size_t requests, size_t concurrency,
+                         AsyncRestClient::HttpVersion version) {
+    AsyncRestClient::Options options;
+    options.httpVersion = version;
+    options.maxHostConnections = version == AsyncRestClient::HttpVersion::Http1_1
+        ? static_cast<long>(concurrency) : 1L;
+    AsyncRestClient client(options);
+
+    BenchmarkResult result;
+    auto wallStart = steady_clock::now();
+    size_t sent = 0;
+    while (sent < requests) {
+        std::vector<std::future<RestResponse>> wave;
+        for (size_t i = 0; i < concurrency && sent < requests; ++i, ++sent) {
+            wave.push_back(client.post(url, kRequestBody, {"Content-Type: application/json"}));
+        }
+        for (auto& future : wave) {
+            RestResponse response = future.get();
+            if (!response.ok) {
+                ++result.failures;
+                continue;
+            }
+            result.latencies.push_back(response.latencyMicros);
+        }
+    }
+    result.wallMicros = duration_cast<microseconds>(steady_clock::now() - wallStart).count();
+    return result;
+}
+
+void printResult(const std::string& name, BenchmarkResult& result) {
+    std::cout << std::left << std::setw(10) << name;
+    if (result.latencies.empty()) {
+        std::cout << "no successful requests (" << result.failures << " failures)" << std::endl;
+        return;
+    }
+    std::sort(result.latencies.begin(), result.latencies.end());
+    auto percentile = [&](double p) {
+        size_t index = static_cast<size_t>(result.latencies.size() * p);
+        return result.latencies[std::min(index, result.latencies.size() - 1)];
+    };
+    double seconds = result.wallMicros / 1e6;
+    std::cout << std::setw(10) << result.latencies.size()
+              << std::setw(10) << result.failures
+              << std::setw(12) << percentile(0.50)
+              << std::setw(12) << percentile(0.99)
+              << std::setw(12) << result.latencies.back()
+              << std::fixed << std::setprecision(1) << (result.latencies.size() / seconds)
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <url> [requests=1000] [concurrency=16] [blocking|http1|http2 ...]" << std::endl;
+        return 1;
+    }
+
+    std::string url = argv[1];
+    size_t requests = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+    size_t concurrency = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 16;
+    std::vector<std::string> modes;
+    for (int i = 4; i < argc; ++i) {
+        modes.push_back(argv[i]);
+    }
+    if (modes.empty()) {
+        modes = {"blocking", "http1", "http2"};
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    bool tls = url.rfind("https://", 0) == 0;
+
+    std::cout << "Target: " << url << ", " << requests << " requests, concurrency " << concurrency << std::endl;
+    std::cout << std::left << std::setw(10) << "mode" << std::setw(10) << "ok" << std::setw(10) << "failed"
+              << std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)" << std::setw(12) << "max (us)"
+              << "req/s" << std::endl;
+
+    for (const auto& mode : modes) {
+        BenchmarkResult result;
+        if (mode == "blocking") {
+            result = runBlocking(url, requests);
+        } else if (mode == "http1") {
+            result = runAsync(url, requests, concurrency, AsyncRestClient::HttpVersion::Http1_1);
+        } else if (mode == "http2") {
+            result = runAsync(url, requests, concurrency,
+                              tls ? AsyncRestClient::HttpVersion::Http2
+                                  : AsyncRestClient::HttpVersion::Http2PriorKnowledge);
+        } else {
+            std::cerr << "Unknown mode: " << mode << std::endl;
+            continue;
+        }
+        printResult(mode, result);
+    }
+
+    curl_global_cleanup();
+    return 0;
+}
@@ -0,0 +1,412 @@
+#ifndef SHM_BUS_H
+#define SHM_BUS_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include "wire_format.h"
+
+// --------------------------------------------------------------------
+// Shared-memory market data bus
+//   One publisher process writes fixed-size records into a ring in
+//   /dev/shm/<name>; any number of reader processes map it read-only and
+//   poll it. Nothing on either side makes a syscall after setup.
+//
+//   - Each slot is a seqlock: the writer marks it odd, fills the record
+//     and marks it even with the message number, so a reader can tell a
+//     complete record from one being written or one already overwritten.
+//   - The writer never waits for readers. A reader that falls a full
+//     ring behind skips ahead and counts what it missed (lost()).
+//   - Each record carries one message in the binary wire format
+//     (wire_format.h), the same one the fan-out sends binary clients.
+//     Records also name their instrument, so a reader that attaches
+//     mid-stream needs no Instrument messages to resolve wire ids.
+//   Layout changes must bump kShmBusVersion; readers refuse other versions.
+// --------------------------------------------------------------------
+
+constexpr uint64_t kShmBusMagic = 0x3153554244524544ull;  // "DERDBUS1"
+constexpr uint32_t kShmBusVersion = 2;
+constexpr size_t kShmTopLevels = 5;
+constexpr size_t kShmInstrumentSize = 32;
+constexpr size_t kShmMessageSize = 256;  // largest wire message a record holds
+constexpr uint64_t kShmDefaultSlots = 1u << 16;
+static_assert(wireBookSize(2 * kShmTopLevels) <= kShmMessageSize, "book tops must fit in a record");
+
+struct ShmRecord {
+    uint64_t publishNanos;                  // CLOCK_MONOTONIC, comparable across processes
+    char instrument[kShmInstrumentSize];    // NUL-terminated
+    uint8_t message[kShmMessageSize];       // one wire message; parse with WireMessage
+};
+static_assert(std::is_trivially_copyable<ShmRecord>::value, "ShmRecord is copied as raw bytes");
+
+struct alignas(64) ShmSlot {
+    // 2n+1 while message n is being written, 2n+2 once it is complete
+    std::atomic<uint64_t> sequence;
+    ShmRecord record;
+};
+
+// Same layout in every bus version, so any publisher can mark an old
+// bus closed before replacing it
+struct ShmBusHeader {
+    std::atomic<uint64_t> magic;  // written last by the publisher, once the ring is ready
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t slotCount;      // power of two
+    alignas(64) std::atomic<uint64_t> published;  // messages written so far
+    std::atomic<uint32_t> closed;                 // publisher has gone away
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+
+inline size_t shmBusSize(uint64_t slotCount) {
+    return (sizeof(ShmBusHeader) + alignof(ShmSlot) - 1) / alignof(ShmSlot) * alignof(ShmSlot) +
+           slotCount * sizeof(ShmSlot);
+}
+
+inline uint64_t shmBusNowNanos() {
+    // steady_clock is CLOCK_MONOTONIC on Linux, shared by every process
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+namespace shm_bus_detail {
+
+// shm_open wants a single leading slash
+inline std::string objectName(const std::string& name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+inline void copyName(char* out, size_t size, const char* in, size_t length) {
+    size_t n = std::min(length, size - 1);
+    std::memcpy(out, in, n);
+    out[n] = '\0';
+}
+
+// Marks an existing bus closed, e.g. one left behind by a publisher that
+// crashed, so readers still attached to it stop waiting and reopen
+inline void markClosed(const std::string& objectName) {
+    int fd = ::shm_open(objectName.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(ShmBusHeader)) {
+        void* mapped = ::mmap(nullptr, sizeof(ShmBusHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            auto* header = static_cast<ShmBusHeader*>(mapped);
+            if (header->magic.load(std::memory_order_acquire) == kShmBusMagic) {
+                header->closed.store(1, std::memory_order_release);
+            }
+            ::munmap(mapped, sizeof(ShmBusHeader));
+        }
+    }
+    ::close(fd);
+}
+
+inline ShmSlot* slotsOf(void* base) {
+    size_t offset = shmBusSize(0);
+    return reinterpret_cast<ShmSlot*>(static_cast<char*>(base) + offset);
+}
+
+} // namespace shm_bus_detail
+
+// --------------------------------------------------------------------
+// ShmBusPublisher: the writing side (one thread of one process)
+// --------------------------------------------------------------------
+class ShmBusPublisher {
+private:
+    std::string objectName;
+    void* base = nullptr;
+    size_t size = 0;
+    ShmBusHeader* header = nullptr;
+    ShmSlot* slots = nullptr;
+    uint64_t mask = 0;
+    uint64_t next = 0;
+    InstrumentRegistry instruments;
+
+    // Seqlock write of the next slot; 'encode(out, capacity)' writes a
+    // wire message of at most 'maxLength' bytes into the record in place
+    template <typename Encode>
+    bool write(const std::string& instrument, size_t maxLength, Encode&& encode) {
+        if (!header || maxLength > kShmMessageSize) {
+            return false;
+        }
+        ShmSlot& slot = slots[next & mask];
+        slot.sequence.store(2 * next + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        ShmRecord& record = slot.record;
+        shm_bus_detail::copyName(record.instrument, kShmInstrumentSize, instrument.data(), instrument.size());
+        encode(record.message, kShmMessageSize);
+        record.publishNanos = shmBusNowNanos();
+
+        slot.sequence.store(2 * next + 2, std::memory_order_release);
+        ++next;
+        header->published.store(next, std::memory_order_release);
+        return true;
+    }
+
+public:
+    ShmBusPublisher() = default;
+    ShmBusPublisher(const ShmBusPublisher&) = delete;
+    ShmBusPublisher& operator=(const ShmBusPublisher&) = delete;
+
+    ~ShmBusPublisher() {
+        close();
+    }
+
+    // Creates (or replaces) /dev/shm/<name>. A replaced bus is marked
+    // closed first, even if its publisher died without close(), so
+    // readers still attached to it see it closed and should reopen.
+    bool create(const std::string& name, uint64_t slotCount = kShmDefaultSlots, std::string* error = nullptr) {
+        close();
+        if (slotCount < 2 || (slotCount & (slotCount - 1)) != 0) {
+            if (error) {
+                *error = "slot count must be a power of two";
+            }
+            return false;
+        }
+        objectName = shm_bus_detail::objectName(name);
+        shm_bus_detail::markClosed(objectName);
+        ::shm_unlink(objectName.c_str());
+        int fd = ::shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) {
+            if (error) {
+                *error = std::strerror(errno);
+            }
+            return false;
+        }
+        size = shmBusSize(slotCount);
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            if (error) {
+                *error = std::strerror(errno);
+            }
+            ::close(fd);
+            ::shm_unlink(objectName.c_str());
+            return false;
+        }
+        base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            if (error) {
+                *error = std::strerror(errno);
+            }
+            base = nullptr;
+            ::shm_unlink(objectName.c_str());
+            return false;
+        }
+
+        // A fresh mapping is zero-filled: every slot starts at sequence 0
+        header = new (base) ShmBusHeader();
+        header->version = kShmBusVersion;
+        header->recordSize = sizeof(ShmRecord);
+        header->slotCount = slotCount;
+        slots = shm_bus_detail::slotsOf(base);
+        mask = slotCount - 1;
+        next = 0;
+        header->magic.store(kShmBusMagic, std::memory_order_release);
+        return true;
+    }
+
+    void close() {
+        if (!base) {
+            return;
+        }
+        header->closed.store(1, std::memory_order_release);
+        ::munmap(base, size);
+        ::shm_unlink(objectName.c_str());
+        base = nullptr;
+        header = nullptr;
+        slots = nullptr;
+    }
+
+    bool isOpen() const { return header != nullptr; }
+    uint64_t publishedCount() const { return next; }
+
+    // Top kShmTopLevels of each side, as a BookSnapshot flagged
+    // kWireTruncated if the book is deeper. Level is PriceLevel.
+    template <typename Level>
+    void publishBookTop(const std::string& instrument, int64_t timestamp, int64_t changeId, uint64_t updateCount,
+                        const Level* bids, size_t bidCount, const Level* asks, size_t askCount) {
+        uint32_t id = instruments.idOf(instrument);
+        write(instrument, wireBookSize(2 * kShmTopLevels), [&](uint8_t* out, size_t capacity) {
+            return encodeWireBook(out, capacity, id, true, updateCount, timestamp, changeId,
+                                  bids, bidCount, asks, askCount, kShmTopLevels);
+        });
+    }
+
+    void publishTrade(const std::string& instrument, const char* tradeId, size_t tradeIdLength, int64_t price,
+                      double amount, uint8_t direction, int64_t timestamp, int64_t tradeSeq) {
+        uint32_t id = instruments.idOf(instrument);
+        write(instrument, sizeof(WireTrade), [&](uint8_t* out, size_t capacity) {
+            return encodeWireTrade(out, capacity, id, std::string_view(tradeId, tradeIdLength), price, amount,
+                                   direction, timestamp, tradeSeq);
+        });
+    }
+
+    // Any other wire message (ticker, order event, ...) encoded by the
+    // caller; false if it does not fit in a record
+    bool publish(const std::string& instrument, const uint8_t* message, size_t length) {
+        return write(instrument, length, [&](uint8_t* out, size_t) {
+            std::memcpy(out, message, length);
+            return length;
+        });
+    }
+
+    // Wire id this bus uses for 'instrument', for messages passed to publish()
+    uint32_t instrumentId(const std::string& instrument) {
+        return instruments.idOf(instrument);
+    }
+};
+
+// --------------------------------------------------------------------
+// ShmBusReader: the polling side; one per reading thread
+//   if (reader.open("deribit_md")) {
+//       ShmRecord record;
+//       WireMessage message;
+//       for (;;) {
+//           if (!reader.poll(record)) {
+//               cpuRelax();
+//           } else if (message.parse(record.message, kShmMessageSize)) {
+//               ...
+//           }
+//       }
+//   }
+// --------------------------------------------------------------------
+class ShmBusReader {
+private:
+    const void* base = nullptr;
+    size_t size = 0;
+    const ShmBusHeader* header = nullptr;
+    const ShmSlot* slots = nullptr;
+    uint64_t slotCount = 0;
+    uint64_t mask = 0;
+    uint64_t next = 0;
+    uint64_t lostCount = 0;
+
+public:
+    ShmBusReader() = default;
+    ShmBusReader(const ShmBusReader&) = delete;
+    ShmBusReader& operator=(const ShmBusReader&) = delete;
+
+    ~ShmBusReader() {
+        close();
+    }
+
+    // Attaches to /dev/shm/<name>. By default reading starts with the
+    // next message published; fromOldest starts with the oldest one
+    // still in the ring.
+    bool open(const std::string& name, bool fromOldest = false, std::string* error = nullptr) {
+        close();
+        auto fail = [&](const std::string& message) {
+            if (error) {
+                *error = message;
+            }
+            close();
+            return false;
+        };
+
+        int fd = ::shm_open(shm_bus_detail::objectName(name).c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return fail(std::strerror(errno));
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < shmBusSize(0)) {
+            ::close(fd);
+            return fail("bus not initialized");
+        }
+        size = static_cast<size_t>(info.st_size);
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return fail(std::strerror(errno));
+        }
+        base = mapped;
+        header = static_cast<const ShmBusHeader*>(base);
+
+        if (header->magic.load(std::memory_order_acquire) != kShmBusMagic) {
+            return fail("bus not initialized");
+        }
+        if (header->version != kShmBusVersion || header->recordSize != sizeof(ShmRecord)) {
+            return fail("bus version " + std::to_string(header->version) + " does not match reader version " +
+                        std::to_string(kShmBusVersion));
+        }
+        slotCount = header->slotCount;
+        if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0 || shmBusSize(slotCount) > size) {
+            return fail("bus header is corrupt");
+        }
+        mask = slotCount - 1;
+        slots = shm_bus_detail::slotsOf(const_cast<void*>(base));
+
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        next = fromOldest && published > slotCount ? published - slotCount : (fromOldest ? 0 : published);
+        lostCount = 0;
+        return true;
+    }
+
+    void close() {
+        if (base) {
+            ::munmap(const_cast<void*>(base), size);
+        }
+        base = nullptr;
+        header = nullptr;
+        slots = nullptr;
+    }
+
+    bool isOpen() const { return header != nullptr; }
+
+    // Copies the next message into 'out' and returns true, or returns
+    // false if there is none yet. Never blocks and makes no syscalls.
+    bool poll(ShmRecord& out) {
+        for (;;) {
+            const ShmSlot& slot = slots[next & mask];
+            uint64_t expected = 2 * next + 2;
+            uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before < expected) {
+                return false;  // not written yet, or still being written
+            }
+            if (before == expected) {
+                std::memcpy(&out, &slot.record, sizeof(ShmRecord));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == before) {
+                    ++next;
+                    return true;
+                }
+            }
+
+            // Overwritten: the publisher is more than a ring ahead. Skip
+            // to half a ring behind it so we do not get lapped again at once.
+            uint64_t published = header->published.load(std::memory_order_acquire);
+            uint64_t resume = published > slotCount / 2 ? published - slotCount / 2 : 0;
+            resume = std::max(resume, next + 1);
+            lostCount += resume - next;
+            next = resume;
+        }
+    }
+
+    // Messages published but not yet polled
+    uint64_t backlog() const {
+        uint64_t published = header->published.load(std::memory_order_acquire);
+        return published > next ? published - next : 0;
+    }
+
+    // Messages overwritten before this reader got to them
+    uint64_t lost() const { return lostCount; }
+
+    // The publisher exited or replaced the bus; reopen to follow it
+    bool publisherClosed() const {
+        return header->closed.load(std::memory_order_acquire) != 0;
+    }
+};
+
+#endif // SHM_BUS_H
@@ -0,0 +1,118 @@
+// --------------------------------------------------------------------
+// Shared-memory bus reader
+//   Attaches to the ring the trading client publishes (DERIBIT_SHM_BUS,
+//   default deribit_md), busy-polls it and prints each record, or with
+//   --quiet only a summary: records read, records lost to lapping and
+//   the publish-to-read latency distribution across processes.
+//
+//   Build:  g++ -std=c++17 -O2 -Iinclude shm_bus_tail.cpp -o shm_bus_tail -lrt
+//   Run:    ./shm_bus_tail [--name deribit_md] [--from-oldest] [--quiet]
+//   Stops on Ctrl-C or when the publisher exits.
+// --------------------------------------------------------------------
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "cpu_relax.h"
+#include "latency_histogram.h"
+#include "order_book.h"
+#include "shm_bus.h"
+#include "wire_format.h"
+
+static std::atomic<bool> g_running{true};
+
+static void printRecord(const ShmRecord& record, const WireMessage& message) {
+    std::cout << std::fixed << std::setprecision(4);
+    if (message.type() == WireType::BookSnapshot || message.type() == WireType::BookDelta) {
+        WireBook book = message.body<WireBook>();
+        std::cout << record.instrument << " book #" << book.seq << " change " << book.changeId;
+        if (book.bidCount > 0) {
+            WireLevel bid = message.level(0);
+            std::cout << "  bid " << bid.amount << " @ " << fromFixedPrice(bid.price);
+        }
+        if (book.askCount > 0) {
+            WireLevel ask = message.level(book.bidCount);
+            std::cout << "  ask " << ask.amount << " @ " << fromFixedPrice(ask.price);
+        }
+        std::cout << std::endl;
+    } else if (message.type() == WireType::Trade) {
+        WireTrade trade = message.body<WireTrade>();
+        const char* side = trade.direction == 1 ? "buy" : trade.direction == 2 ? "sell" : "?";
+        std::cout << record.instrument << " trade " << wireText(trade.tradeId, kWireIdSize) << " " << side << " "
+                  << trade.amount << " @ " << fromFixedPrice(trade.price) << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* envName = std::getenv("DERIBIT_SHM_BUS");
+    std::string name = envName && *envName ? envName : "deribit_md";
+    bool fromOldest = false;
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (arg == "--from-oldest") {
+            fromOldest = true;
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--name deribit_md] [--from-oldest] [--quiet]" << std::endl;
+            return 1;
+        }
+    }
+    std::signal(SIGINT, [](int) { g_running = false; });
+    std::signal(SIGTERM, [](int) { g_running = false; });
+
+    ShmBusReader reader;
+    std::string error;
+    if (!reader.open(name, fromOldest, &error)) {
+        std::cerr << "Cannot open shared-memory bus " << name << ": " << error << std::endl;
+        return 1;
+    }
+    std::cout << "Reading /dev/shm/" << name << " (" << reader.backlog() << " records behind)" << std::endl;
+
+    LatencyHistogram latency;
+    uint64_t books = 0;
+    uint64_t trades = 0;
+    uint64_t malformed = 0;
+    ShmRecord record;
+    WireMessage message;
+    while (g_running) {
+        if (!reader.poll(record)) {
+            // Drain what is left before giving up on a closed ring
+            if (reader.publisherClosed() && reader.backlog() == 0) {
+                std::cout << "Publisher closed the bus" << std::endl;
+                break;
+            }
+            cpuRelax();
+            continue;
+        }
+        uint64_t now = shmBusNowNanos();
+        latency.record(now > record.publishNanos ? now - record.publishNanos : 0);
+        if (!message.parse(record.message, kShmMessageSize)) {
+            ++malformed;
+            continue;
+        }
+        if (message.type() == WireType::Trade) {
+            ++trades;
+        } else {
+            ++books;
+        }
+        if (!quiet) {
+            printRecord(record, message);
+        }
+    }
+
+    std::cout << "\nBook tops: " << books << "  Trades: " << trades << "  Lost: " << reader.lost()
+              << "  Malformed: " << malformed << std::endl;
+    if (latency.count() > 0) {
+        std::cout << "Publish-to-read latency (ns): p50 " << latency.percentile(50)
+                  << "  p99 " << latency.percentile(99)
+                  << "  p99.9 " << latency.percentile(99.9)
+                  << "  max " << latency.max() << std::endl;
+    }
+    return 0;
+}
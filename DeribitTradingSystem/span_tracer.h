@@ -0,0 +1,261 @@
+#ifndef SPAN_TRACER_H
+#define SPAN_TRACER_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "tsc_clock.h"
+
+enum class TracePhase : char {
+    Complete = 'X',     // span with a duration
+    Instant = 'i',
+    AsyncBegin = 'b',   // start of a span that may end on another thread
+    AsyncEnd = 'e'
+};
+
+// --------------------------------------------------------------------
+// SpanTracer: low-overhead span tracing with Chrome trace-event export
+//   - Each thread writes into its own fixed ring of events (relaxed
+//     stores, no lock); the oldest events are overwritten when it wraps.
+//   - Disabled by default; a disabled span costs one relaxed load.
+//   - dumpChromeTrace() writes every ring as a JSON file that loads in
+//     chrome://tracing or ui.perfetto.dev.
+//   Event names must be string literals (only the pointer is stored).
+//   'id' ties events of one order together across threads.
+// --------------------------------------------------------------------
+class SpanTracer {
+public:
+    static constexpr size_t kRingCapacity = 8192; // events per thread, power of two
+
+private:
+    struct Event {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> start{0};      // TscClock ticks
+        std::atomic<uint64_t> duration{0};   // ticks, Complete only
+        std::atomic<uint64_t> id{0};
+        std::atomic<char> phase{'i'};
+    };
+
+    struct ThreadRing {
+        uint32_t tid = 0;
+        std::string threadName;
+        std::array<Event, kRingCapacity> events;
+        std::atomic<uint64_t> head{0}; // events ever written; owner only
+    };
+
+    std::atomic<bool> tracingEnabled{false};
+    std::mutex ringsMutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings; // kept after their thread exits
+    uint32_t nextTid = 1;
+
+    SpanTracer() = default;
+
+    struct ThreadState {
+        std::shared_ptr<ThreadRing> ring; // created on the first event
+        std::string name;
+    };
+
+    static ThreadState& threadState() {
+        static thread_local ThreadState state;
+        return state;
+    }
+
+    ThreadRing& localRing() {
+        ThreadState& state = threadState();
+        if (!state.ring) {
+            state.ring = std::make_shared<ThreadRing>();
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            state.ring->tid = nextTid++;
+            state.ring->threadName = state.name.empty() ? "thread-" + std::to_string(state.ring->tid) : state.name;
+            rings.push_back(state.ring);
+        }
+        return *state.ring;
+    }
+
+    void write(TracePhase phase, const char* name, uint64_t start, uint64_t duration, uint64_t id) {
+        ThreadRing& ring = localRing();
+        uint64_t h = ring.head.load(std::memory_order_relaxed);
+        Event& e = ring.events[h & (kRingCapacity - 1)];
+        e.name.store(name, std::memory_order_relaxed);
+        e.start.store(start, std::memory_order_relaxed);
+        e.duration.store(duration, std::memory_order_relaxed);
+        e.id.store(id, std::memory_order_relaxed);
+        e.phase.store(static_cast<char>(phase), std::memory_order_relaxed);
+        ring.head.store(h + 1, std::memory_order_release);
+    }
+
+public:
+    static SpanTracer& instance() {
+        static SpanTracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const {
+        return tracingEnabled.load(std::memory_order_relaxed);
+    }
+
+    void setEnabled(bool enable) {
+        tracingEnabled.store(enable, std::memory_order_relaxed);
+    }
+
+    // Label the calling thread in the trace viewer (no ring is allocated
+    // until the thread records an event)
+    void setThreadName(const std::string& name) {
+        ThreadState& state = threadState();
+        state.name = name;
+        if (state.ring) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            state.ring->threadName = name;
+        }
+    }
+
+    void complete(const char* name, uint64_t startTicks, uint64_t endTicks, uint64_t id = 0) {
+        if (enabled()) {
+            write(TracePhase::Complete, name, startTicks, endTicks > startTicks ? endTicks - startTicks : 0, id);
+        }
+    }
+
+    void instant(const char* name, uint64_t id = 0) {
+        if (enabled()) {
+            write(TracePhase::Instant, name, TscClock::now(), 0, id);
+        }
+    }
+
+    void asyncBegin(const char* name, uint64_t id) {
+        if (enabled()) {
+            write(TracePhase::AsyncBegin, name, TscClock::now(), 0, id);
+        }
+    }
+
+    void asyncEnd(const char* name, uint64_t id) {
+        if (enabled()) {
+            write(TracePhase::AsyncEnd, name, TscClock::now(), 0, id);
+        }
+    }
+
+    // Write all buffered events as Chrome trace JSON. Safe while other
+    // threads keep tracing; events overwritten mid-dump are skipped.
+    bool dumpChromeTrace(const std::string& path) {
+        struct Captured {
+            uint32_t tid;
+            const char* name;
+            char phase;
+            uint64_t start;
+            uint64_t duration;
+            uint64_t id;
+        };
+        std::vector<Captured> captured;
+        std::vector<std::pair<uint32_t, std::string>> threadNames;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (const auto& ring : rings) {
+                threadNames.emplace_back(ring->tid, ring->threadName);
+                uint64_t end = ring->head.load(std::memory_order_acquire);
+                uint64_t begin = end > kRingCapacity ? end - kRingCapacity : 0;
+                size_t first = captured.size();
+                for (uint64_t i = begin; i < end; ++i) {
+                    const Event& e = ring->events[i & (kRingCapacity - 1)];
+                    captured.push_back(Captured{
+                        ring->tid,
+                        e.name.load(std::memory_order_relaxed),
+                        e.phase.load(std::memory_order_relaxed),
+                        e.start.load(std::memory_order_relaxed),
+                        e.duration.load(std::memory_order_relaxed),
+                        e.id.load(std::memory_order_relaxed)
+                    });
+                }
+                // Drop slots the owner may have reused while we were reading
+                // (including the one it may be writing right now)
+                uint64_t after = ring->head.load(std::memory_order_acquire);
+                if (after + 1 > begin + kRingCapacity) {
+                    size_t overwritten = std::min<uint64_t>(after + 1 - kRingCapacity - begin, end - begin);
+                    captured.erase(captured.begin() + first, captured.begin() + first + overwritten);
+                }
+            }
+        }
+
+        uint64_t base = UINT64_MAX;
+        for (const Captured& c : captured) {
+            base = std::min(base, c.start);
+        }
+
+        nlohmann::json events = nlohmann::json::array();
+        for (const auto& thread : threadNames) {
+            events.push_back({
+                {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", thread.first},
+                {"args", {{"name", thread.second}}}
+            });
+        }
+        for (const Captured& c : captured) {
+            if (!c.name) {
+                continue;
+            }
+            nlohmann::json event = {
+                {"name", c.name},
+                {"cat", "order"},
+                {"ph", std::string(1, c.phase)},
+                {"pid", 1},
+                {"tid", c.tid},
+                {"ts", TscClock::toNanos(c.start - base) / 1000.0}
+            };
+            if (c.phase == static_cast<char>(TracePhase::Complete)) {
+                event["dur"] = TscClock::toNanos(c.duration) / 1000.0;
+            } else if (c.phase == static_cast<char>(TracePhase::Instant)) {
+                event["s"] = "t";
+            }
+            if (c.phase == static_cast<char>(TracePhase::AsyncBegin) ||
+                c.phase == static_cast<char>(TracePhase::AsyncEnd)) {
+                event["id"] = c.id;
+            }
+            if (c.id != 0) {
+                event["args"] = {{"order", c.id}};
+            }
+            events.push_back(std::move(event));
+        }
+
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "Could not write trace to " << path << std::endl;
+            return false;
+        }
+        out << nlohmann::json{{"traceEvents", events}, {"displayTimeUnit", "ns"}}.dump() << std::endl;
+        std::cout << "Wrote " << captured.size() << " trace events to " << path << std::endl;
+        return true;
+    }
+};
+
+// Records a Complete event for its scope (nothing if tracing is off)
+class TraceSpan {
+private:
+    const char* name;
+    uint64_t id;
+    uint64_t start = 0;
+    bool active;
+
+public:
+    explicit TraceSpan(const char* spanName, uint64_t spanId = 0)
+        : name(spanName), id(spanId), active(SpanTracer::instance().enabled()) {
+        if (active) {
+            start = TscClock::now();
+        }
+    }
+
+    ~TraceSpan() {
+        if (active) {
+            SpanTracer::instance().complete(name, start, TscClock::now(), id);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#endif // SPAN_TRACER_H
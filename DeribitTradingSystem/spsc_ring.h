@@ -0,0 +1,111 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "cpu_relax.h"
+
+// --------------------------------------------------------------------
+// SpscRing: bounded single-producer/single-consumer queue
+//   - Slots are allocated once up front and reused; the producer fills
+//     a slot in place (claim/publish) and the consumer reads it in place
+//     (front/pop), so nothing is allocated per message.
+//   - Each side owns one index and keeps a cached copy of the other,
+//     so the shared cache line is only read when the ring looks full
+//     (producer) or empty (consumer).
+//   - When full, the producer drops the message and counts an overflow
+//     instead of waiting for the consumer.
+// --------------------------------------------------------------------
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+private:
+    static constexpr size_t kMask = Capacity - 1;
+
+    std::unique_ptr<T[]> slots;
+
+    // Consumer-owned
+    alignas(64) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+
+    // Producer-owned
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+    std::atomic<uint64_t> overflowCount{0};
+
+public:
+    SpscRing() : slots(new T[Capacity]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Apply 'f' to every slot, e.g. to reserve buffer capacity up front
+    template <typename F>
+    void forEachSlot(F&& f) {
+        for (size_t i = 0; i < Capacity; ++i) {
+            f(slots[i]);
+        }
+    }
+
+    // ----------------------------------------------------------------
+    // Producer side
+    // ----------------------------------------------------------------
+
+    // Returns the next free slot to fill, or nullptr (and counts an
+    // overflow) if the consumer has fallen a full ring behind
+    T* claim() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead >= Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead >= Capacity) {
+                overflowCount.store(overflowCount.load(std::memory_order_relaxed) + 1,
+                                    std::memory_order_relaxed);
+                return nullptr;
+            }
+        }
+        return &slots[t & kMask];
+    }
+
+    // Makes the slot returned by claim() visible to the consumer
+    void publish() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // ----------------------------------------------------------------
+    // Consumer side
+    // ----------------------------------------------------------------
+
+    // Returns the oldest published slot, or nullptr if the ring is empty
+    T* front() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return nullptr;
+            }
+        }
+        return &slots[h & kMask];
+    }
+
+    // Releases the slot returned by front() back to the producer
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // ----------------------------------------------------------------
+    // Statistics (any thread)
+    // ----------------------------------------------------------------
+    uint64_t overflows() const { return overflowCount.load(std::memory_order_relaxed); }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+};
+
+#endif // SPSC_RING_H
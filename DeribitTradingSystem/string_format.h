@@ -0,0 +1,28 @@
+#ifndef STRING_FORMAT_H
+#define STRING_FORMAT_H
+
+#include <cstdio>
+#include <string>
+
+// printf-style append to a string, never truncated: formats straight into
+// the string's tail and, if the line did not fit, once more at the exact
+// length snprintf reported
+template <typename... Args>
+inline void appendFormat(std::string& out, const char* format, Args... args) {
+    constexpr size_t kGuess = 256;
+    size_t start = out.size();
+    out.resize(start + kGuess);
+    int n = std::snprintf(&out[start], kGuess, format, args...);
+    if (n < 0) {
+        out.resize(start);
+        return;
+    }
+    if (static_cast<size_t>(n) >= kGuess) {
+        // Room for the terminator snprintf writes, trimmed below
+        out.resize(start + n + 1);
+        std::snprintf(&out[start], n + 1, format, args...);
+    }
+    out.resize(start + n);
+}
+
+#endif // STRING_FORMAT_H
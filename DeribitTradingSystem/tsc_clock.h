@@ -0,0 +1,133 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define DERIBIT_HAVE_TSC 1
+#endif
+
+// --------------------------------------------------------------------
+// TscClock: cheap monotonic timestamps for hot-path instrumentation
+//   - On x86 with an invariant TSC (constant rate, keeps ticking in deep
+//     C-states), now() is a single RDTSC: a few nanoseconds, no vDSO call.
+//   - The tick rate is calibrated against steady_clock once, on first use.
+//     Ticks convert to nanoseconds with one 64x64 multiply and a shift.
+//   - Without an invariant TSC (other CPUs, some VMs) now() returns
+//     steady_clock nanoseconds instead, so callers never need to care.
+//   Only differences between timestamps are meaningful.
+// --------------------------------------------------------------------
+class TscClock {
+private:
+    struct Calibration {
+        bool useTsc = false;
+        uint64_t nanosPerTickQ32 = 1ull << 32; // ns per tick, 32.32 fixed point
+        double ticksPerNano = 1.0;
+    };
+
+    static uint64_t steadyNanos() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+#ifdef DERIBIT_HAVE_TSC
+    // CPUID 0x80000007, EDX bit 8: TSC runs at a constant rate in all
+    // P-, C- and T-states
+    static bool hasInvariantTsc() {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+            return false;
+        }
+        if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (edx & (1u << 8)) != 0;
+    }
+#endif
+
+    static Calibration calibrate() {
+        Calibration result;
+#ifdef DERIBIT_HAVE_TSC
+        if (!hasInvariantTsc()) {
+            std::cerr << "TscClock: no invariant TSC, using steady_clock" << std::endl;
+            return result;
+        }
+
+        // Spin for ~20 ms; bracketing each steady_clock read between two
+        // RDTSCs keeps the read cost out of the measured interval
+        auto sample = [](uint64_t& tsc, uint64_t& nanos) {
+            uint64_t before = __rdtsc();
+            nanos = steadyNanos();
+            uint64_t after = __rdtsc();
+            tsc = before + (after - before) / 2;
+        };
+        uint64_t tsc0, nanos0, tsc1, nanos1;
+        sample(tsc0, nanos0);
+        do {
+            sample(tsc1, nanos1);
+        } while (nanos1 - nanos0 < 20000000);
+
+        double ticksPerNano = static_cast<double>(tsc1 - tsc0) / static_cast<double>(nanos1 - nanos0);
+        // Reject rates no real TSC runs at (broken virtualization)
+        if (ticksPerNano < 0.1 || ticksPerNano > 10.0) {
+            std::cerr << "TscClock: implausible TSC rate " << ticksPerNano
+                      << " GHz, using steady_clock" << std::endl;
+            return result;
+        }
+        result.useTsc = true;
+        result.ticksPerNano = ticksPerNano;
+        result.nanosPerTickQ32 = static_cast<uint64_t>((1.0 / ticksPerNano) * 4294967296.0);
+#endif
+        return result;
+    }
+
+    static const Calibration& calibration() {
+        static const Calibration instance = calibrate();
+        return instance;
+    }
+
+public:
+    // Force calibration now (e.g. at startup) rather than on first use
+    static void init() {
+        calibration();
+    }
+
+    static bool usingTsc() {
+        return calibration().useTsc;
+    }
+
+    // TSC frequency in GHz (1.0 when falling back to steady_clock)
+    static double ticksPerNano() {
+        return calibration().ticksPerNano;
+    }
+
+    // Current timestamp in ticks
+    static uint64_t now() {
+#ifdef DERIBIT_HAVE_TSC
+        if (calibration().useTsc) {
+            return __rdtsc();
+        }
+#endif
+        return steadyNanos();
+    }
+
+    static uint64_t toNanos(uint64_t ticks) {
+        return static_cast<uint64_t>(
+            (static_cast<unsigned __int128>(ticks) * calibration().nanosPerTickQ32) >> 32);
+    }
+
+    // Elapsed time between two now() values (0 if 'end' precedes 'start')
+    static uint64_t nanosBetween(uint64_t start, uint64_t end) {
+        return end > start ? toNanos(end - start) : 0;
+    }
+
+    static long long microsBetween(uint64_t start, uint64_t end) {
+        return static_cast<long long>(nanosBetween(start, end) / 1000);
+    }
+};
+
+#endif // TSC_CLOCK_H
@@ -5,27 +5,42 @@
 #include <websocketpp/client.hpp>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <functional>
-#include <map>
+#include <vector>
+#include <future>
+#include <unordered_map>
 #include <condition_variable>
 #include <iostream>
 #include <chrono>
 #include "performance_monitor.h"
+#include "notification_parser.h"
+#include "channel_registry.h"
+#include "rcu_ptr.h"
+#include "tsc_clock.h"
+#include "span_tracer.h"
+#include "alloc_tracker.h"
+#include "endpoints.h"
 
 using json = nlohmann::json;
 using namespace std::chrono;
 
 class DeribitWebSocketClient {
 private:
-    // WebSocket++ client type
-    using client = websocketpp::client<websocketpp::config::asio_tls_client>;
+    // WebSocket++ client types: TLS for wss:// URLs, plain TCP for ws://
+    // ones (e.g. a local mock exchange)
+    using tls_client = websocketpp::client<websocketpp::config::asio_tls_client>;
+    using plain_client = websocketpp::client<websocketpp::config::asio_client>;
     using message_ptr = websocketpp::config::asio_client::message_type::ptr;
     using context_ptr = websocketpp::lib::shared_ptr<websocketpp::lib::asio::ssl::context>;
     
-    client m_client;
+    tls_client m_tlsClient;
+    plain_client m_plainClient;
+    std::string m_url;
+    bool m_secure = true; // m_url is wss://
     websocketpp::connection_hdl m_hdl;
     std::thread m_thread;
     std::atomic<bool> m_connected{false};
@@ -35,17 +50,108 @@ private:
     std::string m_clientId;
     std::string m_clientSecret;
     std::string m_accessToken;
+    std::atomic<bool> m_authenticated{false};
     
     // Reference to PerformanceMonitor
     PerformanceMonitor& performanceMonitor;
     
-    // Callbacks for different channels
-    std::map<std::string, std::function<void(const json&)>> m_callbacks;
-    std::mutex m_callbackMutex;
+public:
+    using JsonCallback = std::function<void(const json&)>;
+    using BookCallback = std::function<void(const BookNotification&)>;
+    using TradesCallback = std::function<void(const TradesNotification&)>;
+    using TickerCallback = std::function<void(const TickerNotification&)>;
+    using UserCallback = std::function<void(const UserNotification&)>;
+    using RpcCallback = std::function<void(const json& response)>;
+
+private:
+    // Handlers registered for one channel. Typed handlers get the decoded
+    // notification; a JSON handler forces a full DOM parse of the message.
+    struct ChannelHandlers {
+        JsonCallback onJson;
+        BookCallback onBook;
+        TradesCallback onTrades;
+        TickerCallback onTicker;
+        UserCallback onUser;
+    };
+
+    // Callbacks for different channels: names are interned to dense IDs
+    // when registered, and handlers is indexed by that ID
+    struct HandlerTable {
+        ChannelRegistry channels;
+        std::vector<std::shared_ptr<const ChannelHandlers>> handlers;
+        std::vector<PerformanceMonitor::FeedSeriesId> feedSeries; // feed latency series per channel
+    };
+
+    // Dispatch reads the table wait-free on the IO thread; registration
+    // and unsubscribe publish a modified copy, so neither side ever
+    // waits for the other (or for a slow handler)
+    RcuPtr<HandlerTable> m_handlerTable;
+
+    // Decodes subscription notifications without building a DOM (IO thread only)
+    NotificationParser m_parser;
+
+    // JSON-RPC requests sent over the socket that are awaiting a reply.
+    // IDs below kFirstRequestId are the fixed ones used for auth/subscribe.
+    static constexpr uint64_t kFirstRequestId = 10000;
+
+    struct PendingRequest {
+        std::shared_ptr<std::promise<json>> promise;
+        RpcCallback callback;
+        uint64_t sentAt = 0; // TscClock ticks
+        uint64_t traceId = 0; // SpanTracer id of the order this belongs to
+    };
+
+    std::atomic<uint64_t> m_nextRequestId{kFirstRequestId};
+    std::unordered_map<uint64_t, PendingRequest> m_pendingRequests;
+    std::mutex m_pendingMutex;
+    
+    // When the last message arrived (TscClock ticks), for tick-to-trade
+    std::atomic<uint64_t> m_lastMessageTicks{0};
     
     // Connection callback
     std::function<void(bool)> m_connectionCallback;
     
+    // Run 'action' on the endpoint that serves m_url
+    template <typename Action>
+    void withEndpoint(Action&& action) {
+        if (m_secure) {
+            action(m_tlsClient);
+        } else {
+            action(m_plainClient);
+        }
+    }
+
+    // Logging and handlers shared by both endpoint types
+    template <typename Endpoint>
+    void initEndpoint(Endpoint& endpoint) {
+        endpoint.clear_access_channels(websocketpp::log::alevel::all);
+        endpoint.clear_error_channels(websocketpp::log::elevel::all);
+        
+        endpoint.init_asio();
+        
+        endpoint.set_message_handler([this](websocketpp::connection_hdl hdl, message_ptr msg) {
+            this->on_message(hdl, msg);
+        });
+        
+        endpoint.set_open_handler([this](websocketpp::connection_hdl hdl) {
+            this->on_open(hdl);
+        });
+        
+        endpoint.set_close_handler([this](websocketpp::connection_hdl hdl) {
+            this->on_close(hdl);
+        });
+        
+        endpoint.set_fail_handler([this](websocketpp::connection_hdl hdl) {
+            this->on_fail(hdl);
+        });
+    }
+
+    void sendText(const std::string& message) {
+        withEndpoint([&](auto& endpoint) {
+            endpoint.send(m_hdl, message, websocketpp::frame::opcode::text);
+        });
+    }
+    
     // TLS initialization
     context_ptr on_tls_init() {
         context_ptr ctx = websocketpp::lib::make_shared<websocketpp::lib::asio::ssl::context>(
@@ -86,53 +192,263 @@ private:
         std::string message = authRequest.dump();
         
         try {
-            m_client.send(m_hdl, message, websocketpp::frame::opcode::text);
+            sendText(message);
             std::cout << "Authentication request sent" << std::endl;
         } catch (const std::exception& e) {
             std::cerr << "Error sending authentication request: " << e.what() << std::endl;
         }
     }
     
-    // Process incoming messages
-    void on_message(websocketpp::connection_hdl hdl, message_ptr msg) {
-        auto start = high_resolution_clock::now(); // Start timing
+    // Complete a pending sendRpc() request; returns false if 'id' is not ours.
+    // 'receivedAt' is when the reply's frame arrived (TscClock ticks).
+    bool completePendingRequest(uint64_t id, const json& response, uint64_t receivedAt) {
+        PendingRequest request;
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            auto it = m_pendingRequests.find(id);
+            if (it == m_pendingRequests.end()) {
+                return false;
+            }
+            request = std::move(it->second);
+            m_pendingRequests.erase(it);
+        }
+        
+        uint64_t now = TscClock::now();
+        performanceMonitor.recordLatency(LatencyMetric::WsRpcRtt, TscClock::nanosBetween(request.sentAt, now));
+        // Frame arrival through parse and lookup, then hand-off to the caller
+        SpanTracer::instance().complete("rpc.receive", receivedAt, now, request.traceId);
+        TraceSpan completeSpan("rpc.complete", request.traceId);
+        
+        if (request.callback) {
+            request.callback(response);
+        }
+        if (request.promise) {
+            request.promise->set_value(response);
+        }
+        return true;
+    }
 
-        try {
-            json data = json::parse(msg->get_payload());
-            
-            // Handle authentication response
-            if (data.contains("id") && data["id"] == 9929 && data.contains("result")) {
-                m_accessToken = data["result"]["access_token"];
-                std::cout << "Successfully authenticated with Deribit" << std::endl;
+    // Fail every outstanding request (e.g. when the connection drops)
+    void failPendingRequests(const std::string& reason) {
+        std::unordered_map<uint64_t, PendingRequest> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            pending.swap(m_pendingRequests);
+        }
+        
+        for (auto& [id, request] : pending) {
+            json error = {
+                {"jsonrpc", "2.0"},
+                {"id", id},
+                {"error", {{"code", -1}, {"message", reason}}}
+            };
+            if (request.callback) {
+                request.callback(error);
+            }
+            if (request.promise) {
+                request.promise->set_value(error);
+            }
+        }
+    }
+
+    // Handle replies to our own requests (auth, subscribe, orders, ...)
+    void handleRpcResponse(const std::string& payload, uint64_t receivedAt) {
+        json data = json::parse(payload);
+        
+        // Handle authentication response
+        if (data.contains("id") && data["id"] == 9929 && data.contains("result")) {
+            m_accessToken = data["result"]["access_token"];
+            m_authenticated = true;
+            std::cout << "Successfully authenticated with Deribit" << std::endl;
+            return;
+        }
+        
+        // Handle replies to sendRpc()
+        if (data.contains("id") && data["id"].is_number_unsigned() &&
+            completePendingRequest(data["id"].get<uint64_t>(), data, receivedAt)) {
+            return;
+        }
+        
+        // Handle subscription responses
+        if (data.contains("id") && data.contains("result") && data["result"].is_array()) {
+            std::cout << "Subscription successful: " << data.dump() << std::endl;
+            return;
+        }
+    }
+
+    // Hand a parsed notification to the handlers registered for its channel
+    void dispatchNotification(NotificationKind kind, const std::string& payload, int64_t receivedAtMicros) {
+        m_handlerTable.read([&](const HandlerTable& table) {
+            ChannelId id = table.channels.find(m_parser.getChannel());
+            if (id == kInvalidChannel) {
                 return;
             }
-            
-            // Handle subscription responses
-            if (data.contains("id") && data.contains("result") && data["result"].is_array()) {
-                std::cout << "Subscription successful: " << data.dump() << std::endl;
+            performanceMonitor.recordFeedLatency(table.feedSeries[id], exchangeTimestamp(kind), receivedAtMicros);
+            if (!table.handlers[id]) {
                 return;
             }
+            invokeHandlers(kind, *table.handlers[id], payload);
+        });
+    }
+
+    void invokeHandlers(NotificationKind kind, const ChannelHandlers& handlers, const std::string& payload) {
+        switch (kind) {
+            case NotificationKind::Book:
+                if (handlers.onBook) handlers.onBook(m_parser.getBook());
+                break;
+            case NotificationKind::Trades:
+                if (handlers.onTrades) handlers.onTrades(m_parser.getTrades());
+                break;
+            case NotificationKind::Ticker:
+                if (handlers.onTicker) handlers.onTicker(m_parser.getTicker());
+                break;
+            case NotificationKind::User:
+                if (handlers.onUser) handlers.onUser(m_parser.getUser());
+                break;
+            default:
+                break;
+        }
+        
+        // Only channels with a JSON handler pay for the DOM
+        if (handlers.onJson) {
+            json data = json::parse(payload);
+            handlers.onJson(data);
+        }
+    }
+
+    // Process incoming messages
+    void on_message(websocketpp::connection_hdl hdl, message_ptr msg) {
+        uint64_t start = TscClock::now(); // Start timing
+        // Wall clock for comparison with exchange timestamps
+        int64_t receivedAtMicros = wallMicros();
+
+        m_lastMessageTicks.store(start, std::memory_order_relaxed);
+        AllocScope allocScope(AllocTag::WebSocket);
+        HardwareCounters::Scope hwScope(performanceMonitor.hardware(), HwOp::FeedMessage);
+
+        try {
+            const std::string& payload = msg->get_payload();
+            NotificationKind kind;
+            {
+                // The parser must not allocate
+                AllocScope parserScope(AllocTag::Parser);
+                HotPathScope hotPath;
+                kind = m_parser.parse(payload);
+            }
+            uint64_t parsed = TscClock::now();
+            performanceMonitor.recordLatency(LatencyMetric::Parse, TscClock::nanosBetween(start, parsed));
             
-            // Handle channel data
-            if (data.contains("method") && data["method"] == "subscription" && 
-                data.contains("params") && data["params"].contains("channel")) {
-                
-                std::string channel = data["params"]["channel"];
-                
-                // Find and execute the appropriate callback
-                std::lock_guard<std::mutex> lock(m_callbackMutex);
-                auto it = m_callbacks.find(channel);
-                if (it != m_callbacks.end()) {
-                    it->second(data);
-                }
+            if (kind == NotificationKind::RpcResponse || kind == NotificationKind::Invalid) {
+                // Fall back to nlohmann for RPC responses (and let it report bad JSON)
+                handleRpcResponse(payload, start);
+            } else if (!m_parser.getChannel().empty()) {
+                performanceMonitor.recordMarketDataMessage();
+                dispatchNotification(kind, payload, receivedAtMicros);
+                performanceMonitor.recordLatency(LatencyMetric::Dispatch, TscClock::nanosBetween(parsed, TscClock::now()));
             }
         } catch (const std::exception& e) {
             std::cerr << "Error processing message: " << e.what() << std::endl;
         }
+    }
+    
+    // Returns the handler slot for a channel in a table being updated,
+    // interning the channel (and its feed latency series) if needed
+    std::shared_ptr<const ChannelHandlers>& handlersFor(HandlerTable& table, const std::string& channel) {
+        ChannelId id = table.channels.intern(channel);
+        if (id >= table.handlers.size()) {
+            table.handlers.resize(id + 1);
+            table.feedSeries.resize(id + 1, PerformanceMonitor::kNoFeedSeries);
+            table.feedSeries[id] = performanceMonitor.registerFeedSeries(channel);
+        }
+        return table.handlers[id];
+    }
+
+    static int64_t wallMicros() {
+        return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    }
+
+    // Exchange timestamp carried by a decoded notification (ms, 0 if none)
+    int64_t exchangeTimestamp(NotificationKind kind) const {
+        switch (kind) {
+            case NotificationKind::Book:
+                return m_parser.getBook().timestamp;
+            case NotificationKind::Trades: {
+                const TradesNotification& trades = m_parser.getTrades();
+                return trades.count > 0 ? trades.trades[trades.count - 1].timestamp : 0;
+            }
+            case NotificationKind::Ticker:
+                return m_parser.getTicker().timestamp;
+            default:
+                return 0;
+        }
+    }
 
-        auto end = high_resolution_clock::now(); // End timing
-        auto latency = duration_cast<microseconds>(end - start).count();
-        performanceMonitor.recordWebSocketApiLatency(latency); // Use the correct method name
+    // Publishes a new table where 'channel' has 'modify' applied to its handlers
+    template <typename F>
+    void updateHandlers(const std::string& channel, F&& modify) {
+        m_handlerTable.update([&](HandlerTable& table) {
+            auto& slot = handlersFor(table, channel);
+            auto handlers = slot ? std::make_shared<ChannelHandlers>(*slot) : std::make_shared<ChannelHandlers>();
+            modify(*handlers);
+            slot = std::move(handlers);
+        });
+    }
+    
+    uint64_t sendRpcInternal(const std::string& method, const json& params, RpcCallback callback,
+                             std::shared_ptr<std::promise<json>> promise) {
+        uint64_t id = m_nextRequestId.fetch_add(1, std::memory_order_relaxed);
+        json request = {
+            {"jsonrpc", "2.0"},
+            {"id", id},
+            {"method", method},
+            {"params", params}
+        };
+        return sendPrepared(id, method, request.dump(), std::move(callback), std::move(promise), 0);
+    }
+    
+    // Send an already serialized request whose "id" field is 'id'
+    uint64_t sendPrepared(uint64_t id, const std::string& method, std::string_view message,
+                          RpcCallback callback, std::shared_ptr<std::promise<json>> promise, uint64_t traceId) {
+        // Register before sending so a fast reply always finds its entry
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            m_pendingRequests[id] = PendingRequest{promise, callback, TscClock::now(), traceId};
+        }
+        
+        std::string error;
+        if (message.empty()) {
+            error = "Invalid request parameters";
+        } else if (!m_connected) {
+            error = "Not connected to WebSocket server";
+        } else {
+            try {
+                TraceSpan sendSpan("rpc.send", traceId);
+                withEndpoint([&](auto& endpoint) {
+                    endpoint.send(m_hdl, message.data(), message.size(), websocketpp::frame::opcode::text);
+                });
+                return id;
+            } catch (const std::exception& e) {
+                error = std::string("Error sending request: ") + e.what();
+            }
+        }
+        
+        std::cerr << method << " failed: " << error << std::endl;
+        {
+            std::lock_guard<std::mutex> lock(m_pendingMutex);
+            m_pendingRequests.erase(id);
+        }
+        json response = {
+            {"jsonrpc", "2.0"},
+            {"id", id},
+            {"error", {{"code", -1}, {"message", error}}}
+        };
+        if (callback) {
+            callback(response);
+        }
+        if (promise) {
+            promise->set_value(response);
+        }
+        return 0;
     }
     
     // Connection handlers
@@ -147,6 +463,9 @@ private:
             authenticate();
         }
         
+        // Needed to tell network delay from clock skew in feed latency
+        syncExchangeClock();
+        
         // Notify via callback if registered
         if (m_connectionCallback) {
             m_connectionCallback(true);
@@ -155,7 +474,9 @@ private:
     
     void on_close(websocketpp::connection_hdl hdl) {
         m_connected = false;
+        m_authenticated = false;
         std::cout << "WebSocket connection closed" << std::endl;
+        failPendingRequests("WebSocket connection closed");
         
         // Notify via callback if registered
         if (m_connectionCallback) {
@@ -165,7 +486,9 @@ private:
     
     void on_fail(websocketpp::connection_hdl hdl) {
         m_connected = false;
+        m_authenticated = false;
         std::cerr << "WebSocket connection failed" << std::endl;
+        failPendingRequests("WebSocket connection failed");
         
         // Notify via callback if registered
         if (m_connectionCallback) {
@@ -174,34 +497,18 @@ private:
     }
 
 public:
-    DeribitWebSocketClient(const std::string& clientId, const std::string& clientSecret, PerformanceMonitor& pm)
-        : m_clientId(clientId), m_clientSecret(clientSecret), performanceMonitor(pm) {
-        
-        // Initialize WebSocket client
-        m_client.clear_access_channels(websocketpp::log::alevel::all);
-        m_client.clear_error_channels(websocketpp::log::elevel::all);
+    // 'url' is the WebSocket API endpoint, ws:// or wss://
+    DeribitWebSocketClient(const std::string& clientId, const std::string& clientSecret, PerformanceMonitor& pm,
+                           const std::string& url = DeribitEndpoints::fromEnvironment().wsUrl)
+        : m_url(url), m_secure(url.compare(0, 6, "wss://") == 0),
+          m_clientId(clientId), m_clientSecret(clientSecret), performanceMonitor(pm) {
         
-        m_client.init_asio();
-        m_client.set_tls_init_handler([this](websocketpp::connection_hdl) {
+        // Initialize WebSocket clients
+        initEndpoint(m_tlsClient);
+        initEndpoint(m_plainClient);
+        m_tlsClient.set_tls_init_handler([this](websocketpp::connection_hdl) {
             return this->on_tls_init();
         });
-        
-        // Set handlers
-        m_client.set_message_handler([this](websocketpp::connection_hdl hdl, message_ptr msg) {
-            this->on_message(hdl, msg);
-        });
-        
-        m_client.set_open_handler([this](websocketpp::connection_hdl hdl) {
-            this->on_open(hdl);
-        });
-        
-        m_client.set_close_handler([this](websocketpp::connection_hdl hdl) {
-            this->on_close(hdl);
-        });
-        
-        m_client.set_fail_handler([this](websocketpp::connection_hdl hdl) {
-            this->on_fail(hdl);
-        });
     }
     
     ~DeribitWebSocketClient() {
@@ -219,20 +526,21 @@ public:
         
         // Start the WebSocket client in a separate thread
         m_thread = std::thread([this]() {
+            SpanTracer::instance().setThreadName("websocket-io");
             try {
-                // Connect to Deribit WebSocket API
-                std::string wsUrl = "wss://test.deribit.com/ws/api/v2";
-                websocketpp::lib::error_code ec;
-                client::connection_ptr con = m_client.get_connection(wsUrl, ec);
-                
-                if (ec) {
-                    std::cerr << "Could not create connection: " << ec.message() << std::endl;
-                    m_running = false;
-                    return;
-                }
-                
-                m_client.connect(con);
-                m_client.run();
+                // Connect to the Deribit WebSocket API
+                withEndpoint([this](auto& endpoint) {
+                    websocketpp::lib::error_code ec;
+                    auto con = endpoint.get_connection(m_url, ec);
+                    
+                    if (ec) {
+                        std::cerr << "Could not create connection to " << m_url << ": " << ec.message() << std::endl;
+                        return;
+                    }
+                    
+                    endpoint.connect(con);
+                    endpoint.run();
+                });
             } catch (const std::exception& e) {
                 std::cerr << "Exception in WebSocket thread: " << e.what() << std::endl;
             }
@@ -250,12 +558,14 @@ public:
         
         try {
             // Close the WebSocket connection
-            if (m_connected) {
-                m_client.close(m_hdl, websocketpp::close::status::normal, "Client disconnecting");
-            }
-            
-            // Stop the WebSocket client
-            m_client.stop();
+            withEndpoint([this](auto& endpoint) {
+                if (m_connected) {
+                    endpoint.close(m_hdl, websocketpp::close::status::normal, "Client disconnecting");
+                }
+                
+                // Stop the WebSocket client
+                endpoint.stop();
+            });
             m_running = false;
             
             // Wait for the thread to finish
@@ -274,18 +584,24 @@ public:
             return false;
         }
         
+        m_handlerTable.update([&](HandlerTable& table) {
+            handlersFor(table, channel);
+        });
+        
         try {
+            // user.* channels are private and need the authenticated method
+            bool isPrivate = channel.compare(0, 5, "user.") == 0;
             json subscriptionRequest = {
                 {"jsonrpc", "2.0"},
                 {"id", 42},
-                {"method", "public/subscribe"},
+                {"method", isPrivate ? "private/subscribe" : "public/subscribe"},
                 {"params", {
                     {"channels", {channel}}
                 }}
             };
             
             std::string message = subscriptionRequest.dump();
-            m_client.send(m_hdl, message, websocketpp::frame::opcode::text);
+            sendText(message);
             std::cout << "Subscription request sent for channel: " << channel << std::endl;
             return true;
         } catch (const std::exception& e) {
@@ -305,18 +621,22 @@ public:
             json unsubscribeRequest = {
                 {"jsonrpc", "2.0"},
                 {"id", 43},
-                {"method", "public/unsubscribe"},
+                {"method", channel.compare(0, 5, "user.") == 0 ? "private/unsubscribe" : "public/unsubscribe"},
                 {"params", {
                     {"channels", {channel}}
                 }}
             };
             
             std::string message = unsubscribeRequest.dump();
-            m_client.send(m_hdl, message, websocketpp::frame::opcode::text);
+            sendText(message);
             
-            // Remove the callback
-            std::lock_guard<std::mutex> lock(m_callbackMutex);
-            m_callbacks.erase(channel);
+            // Remove the callbacks (the channel keeps its ID)
+            m_handlerTable.update([&](HandlerTable& table) {
+                ChannelId id = table.channels.find(channel);
+                if (id != kInvalidChannel) {
+                    table.handlers[id].reset();
+                }
+            });
             
             return true;
         } catch (const std::exception& e) {
@@ -325,10 +645,75 @@ public:
         }
     }
     
-    // Register a callback for a specific channel
-    void registerCallback(const std::string& channel, std::function<void(const json&)> callback) {
-        std::lock_guard<std::mutex> lock(m_callbackMutex);
-        m_callbacks[channel] = callback;
+    // Send a JSON-RPC request over the socket. The reply (or an error
+    // object if the send fails or the connection drops) is delivered to
+    // 'callback' on the IO thread. Returns the request id, or 0 on failure.
+    uint64_t sendRpc(const std::string& method, const json& params, RpcCallback callback) {
+        return sendRpcInternal(method, params, std::move(callback), nullptr);
+    }
+
+    // Same as above, but the reply completes the returned future
+    std::future<json> sendRpc(const std::string& method, const json& params) {
+        auto promise = std::make_shared<std::promise<json>>();
+        std::future<json> future = promise->get_future();
+        sendRpcInternal(method, params, nullptr, promise);
+        return future;
+    }
+
+    // Send a request serialized by the caller, e.g. from an order template.
+    // 'encode(id)' must return the full request text carrying that id (or
+    // an empty view if the parameters are invalid); it is sent as is.
+    // Trace spans for the send and the reply are tagged with 'traceId'.
+    // 'callback', if set, runs on the IO thread before the future is
+    // completed, even if nobody waits for the future any more.
+    template <typename Encode>
+    std::future<json> sendEncodedRpc(const std::string& method, Encode&& encode, uint64_t traceId = 0,
+                                     RpcCallback callback = nullptr) {
+        auto promise = std::make_shared<std::promise<json>>();
+        std::future<json> future = promise->get_future();
+        uint64_t id = m_nextRequestId.fetch_add(1, std::memory_order_relaxed);
+        sendPrepared(id, method, encode(id), std::move(callback), promise, traceId);
+        return future;
+    }
+
+    // Estimate the offset between our clock and the exchange's from
+    // 'samples' back-to-back public/get_time round trips (non-blocking;
+    // each reply sends the next request from the IO thread)
+    void syncExchangeClock(int samples = 8) {
+        if (samples <= 0) {
+            return;
+        }
+        int64_t sentAt = wallMicros();
+        sendRpc("public/get_time", json::object(), [this, samples, sentAt](const json& response) {
+            int64_t receivedAt = wallMicros();
+            if (!response.contains("result") || !response["result"].is_number_integer()) {
+                return;
+            }
+            performanceMonitor.recordClockSample(sentAt, receivedAt, response["result"].get<int64_t>());
+            syncExchangeClock(samples - 1);
+        });
+    }
+
+    // Register a callback for a specific channel (receives the full JSON message)
+    void registerCallback(const std::string& channel, JsonCallback callback) {
+        updateHandlers(channel, [&](ChannelHandlers& handlers) { handlers.onJson = callback; });
+    }
+
+    // Typed callbacks: receive the decoded notification, no JSON DOM is built
+    void registerBookCallback(const std::string& channel, BookCallback callback) {
+        updateHandlers(channel, [&](ChannelHandlers& handlers) { handlers.onBook = callback; });
+    }
+
+    void registerTradesCallback(const std::string& channel, TradesCallback callback) {
+        updateHandlers(channel, [&](ChannelHandlers& handlers) { handlers.onTrades = callback; });
+    }
+
+    void registerTickerCallback(const std::string& channel, TickerCallback callback) {
+        updateHandlers(channel, [&](ChannelHandlers& handlers) { handlers.onTicker = callback; });
+    }
+
+    void registerUserCallback(const std::string& channel, UserCallback callback) {
+        updateHandlers(channel, [&](ChannelHandlers& handlers) { handlers.onUser = callback; });
     }
     
     // Set connection callback
@@ -340,6 +725,16 @@ public:
     bool isConnected() const {
         return m_connected;
     }
+
+    // TscClock timestamp of the most recent incoming message (0 if none)
+    uint64_t lastMessageTicks() const {
+        return m_lastMessageTicks.load(std::memory_order_relaxed);
+    }
+
+    // Check if the session is authenticated (required for private/* methods)
+    bool isAuthenticated() const {
+        return m_connected && m_authenticated;
+    }
 };
 
 #endif // WEBSOCKET_CLIENT_H 
\ No newline at end of file
@@ -0,0 +1,230 @@
+// --------------------------------------------------------------------
+// Wire format microbenchmark
+//   Compares encoding and decoding downstream messages as nlohmann::json
+//   (what the fan-out sends JSON clients) against the binary wire format
+//   of wire_format.h, for a 10-level book delta, a trade, a ticker and an
+//   order event. Decoding reads every field back out.
+//
+//   Build:  g++ -std=c++17 -O2 -Iinclude wire_benchmark.cpp -o wire_benchmark
+//   Run:    ./wire_benchmark [iterations]
+// --------------------------------------------------------------------
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <nlohmann/json.hpp>
+#include "notification_parser.h"
+#include "wire_format.h"
+
+using json = nlohmann::json;
+using namespace std::chrono;
+
+// Keeps the optimizer from discarding the encoded and decoded output
+static volatile double sink;
+
+template <typename F>
+double nanosPerOp(size_t iterations, F&& f) {
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        f(i);
+    }
+    auto end = steady_clock::now();
+    return duration_cast<nanoseconds>(end - start).count() / static_cast<double>(iterations);
+}
+
+void report(const std::string& name, double jsonNanos, double wireNanos, size_t jsonBytes, size_t wireBytes) {
+    std::cout << std::left << std::setw(16) << name << std::fixed << std::setprecision(1)
+              << std::setw(12) << jsonNanos << std::setw(12) << wireNanos
+              << std::setw(10) << jsonNanos / wireNanos
+              << jsonBytes << " / " << wireBytes << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::string instrument = "BTC-PERPETUAL";
+    const uint32_t instrumentId = 1;
+    uint8_t buffer[4096];
+
+    constexpr size_t kLevels = 10;
+    LevelUpdate bids[kLevels];
+    LevelUpdate asks[kLevels];
+    for (size_t i = 0; i < kLevels; ++i) {
+        bids[i] = LevelUpdate{toFixedPrice(42000.0 - 0.5 * i), 10.0 + i, LevelAction::Change};
+        asks[i] = LevelUpdate{toFixedPrice(42000.5 + 0.5 * i), 20.0 + i, LevelAction::New};
+    }
+    // Vary one price so neither path formats the same number twice
+    auto priceOf = [](size_t i) { return 42000.5 + static_cast<double>(i % 1000) * 0.5; };
+
+    TickerNotification ticker;
+    ticker.timestamp = 1700000000000;
+    ticker.bestBidPrice = 42000.0;
+    ticker.bestBidAmount = 1500.0;
+    ticker.bestAskPrice = 42000.5;
+    ticker.bestAskAmount = 2500.0;
+    ticker.lastPrice = 42000.5;
+    ticker.markPrice = 42000.25;
+    ticker.indexPrice = 41998.75;
+    ticker.openInterest = 123456789.0;
+
+    OrderEvent order;
+    order.orderId = "ETH-3452187654";
+    order.orderState = "open";
+    order.direction = TradeDirection::Buy;
+    order.price = 2250.5;
+    order.amount = 10.0;
+    order.filledAmount = 4.0;
+    order.timestamp = 1700000000000;
+
+    // ---- book delta ----
+    auto bookJson = [&](size_t i) {
+        json bidLevels = json::array();
+        json askLevels = json::array();
+        for (size_t k = 0; k < kLevels; ++k) {
+            bidLevels.push_back({fromFixedPrice(bids[k].price), bids[k].amount});
+            askLevels.push_back({k == 0 ? priceOf(i) : fromFixedPrice(asks[k].price), asks[k].amount});
+        }
+        return json{
+            {"type", "book"}, {"instrument", instrument}, {"seq", i}, {"timestamp", 1700000000000 + i},
+            {"change_id", i}, {"snapshot", false}, {"bids", bidLevels}, {"asks", askLevels}
+        }.dump();
+    };
+    auto bookWire = [&](size_t i) {
+        asks[0].price = toFixedPrice(priceOf(i));
+        return encodeWireBook(buffer, sizeof(buffer), instrumentId, false, i, 1700000000000 + i, i,
+                              bids, kLevels, asks, kLevels);
+    };
+    std::string bookText = bookJson(7);
+    size_t bookBytes = bookWire(7);
+    WireMessage message;
+    if (!message.parse(buffer, bookBytes) || message.level(kLevels).price != toFixedPrice(priceOf(7)) ||
+        json::parse(bookText)["asks"][0][0].get<double>() != priceOf(7)) {
+        std::cerr << "Book delta does not round-trip" << std::endl;
+        return 1;
+    }
+    double bookEncodeJson = nanosPerOp(iterations, [&](size_t i) { sink = bookJson(i).size(); });
+    double bookEncodeWire = nanosPerOp(iterations, [&](size_t i) { sink = bookWire(i); });
+    double bookDecodeJson = nanosPerOp(iterations, [&](size_t) {
+        json update = json::parse(bookText);
+        double sum = update["seq"].get<uint64_t>() + update["change_id"].get<int64_t>();
+        for (const auto& level : update["bids"]) sum += level[0].get<double>() + level[1].get<double>();
+        for (const auto& level : update["asks"]) sum += level[0].get<double>() + level[1].get<double>();
+        sink = sum;
+    });
+    double bookDecodeWire = nanosPerOp(iterations, [&](size_t) {
+        WireMessage update;
+        update.parse(buffer, bookBytes);
+        WireBook book = update.body<WireBook>();
+        double sum = static_cast<double>(book.seq) + book.changeId;
+        for (size_t k = 0; k < book.bidCount + book.askCount; ++k) {
+            WireLevel level = update.level(k);
+            sum += fromFixedPrice(level.price) + level.amount;
+        }
+        sink = sum;
+    });
+
+    // ---- trade ----
+    auto tradeJson = [&](size_t i) {
+        return json{
+            {"type", "trades"}, {"instrument", instrument},
+            {"trades", json::array({{
+                {"trade_id", "BTC-123456789"}, {"price", priceOf(i)}, {"amount", 10.0},
+                {"direction", "buy"}, {"timestamp", 1700000000000 + i}
+            }})}
+        }.dump();
+    };
+    auto tradeWire = [&](size_t i) {
+        return encodeWireTrade(buffer, sizeof(buffer), instrumentId, "BTC-123456789", toFixedPrice(priceOf(i)),
+                               10.0, 1, 1700000000000 + i, i);
+    };
+    std::string tradeText = tradeJson(7);
+    size_t tradeBytes = tradeWire(7);
+    double tradeEncodeJson = nanosPerOp(iterations, [&](size_t i) { sink = tradeJson(i).size(); });
+    double tradeEncodeWire = nanosPerOp(iterations, [&](size_t i) { sink = tradeWire(i); });
+    double tradeDecodeJson = nanosPerOp(iterations, [&](size_t) {
+        json update = json::parse(tradeText);
+        const json& trade = update["trades"][0];
+        sink = trade["price"].get<double>() + trade["amount"].get<double>() +
+               trade["trade_id"].get<std::string>().size() + (trade["direction"] == "buy");
+    });
+    double tradeDecodeWire = nanosPerOp(iterations, [&](size_t) {
+        WireMessage update;
+        update.parse(buffer, tradeBytes);
+        WireTrade trade = update.body<WireTrade>();
+        sink = fromFixedPrice(trade.price) + trade.amount + wireText(trade.tradeId, kWireIdSize).size() +
+               (trade.direction == 1);
+    });
+
+    // ---- ticker ----
+    auto tickerJson = [&](size_t i) {
+        return json{
+            {"type", "ticker"}, {"instrument", instrument}, {"timestamp", ticker.timestamp + i},
+            {"best_bid_price", ticker.bestBidPrice}, {"best_bid_amount", ticker.bestBidAmount},
+            {"best_ask_price", priceOf(i)}, {"best_ask_amount", ticker.bestAskAmount},
+            {"last_price", ticker.lastPrice}, {"mark_price", ticker.markPrice},
+            {"index_price", ticker.indexPrice}, {"open_interest", ticker.openInterest}
+        }.dump();
+    };
+    auto tickerWire = [&](size_t i) {
+        ticker.bestAskPrice = priceOf(i);
+        return encodeWireTicker(buffer, sizeof(buffer), instrumentId, ticker);
+    };
+    std::string tickerText = tickerJson(7);
+    size_t tickerBytes = tickerWire(7);
+    double tickerEncodeJson = nanosPerOp(iterations, [&](size_t i) { sink = tickerJson(i).size(); });
+    double tickerEncodeWire = nanosPerOp(iterations, [&](size_t i) { sink = tickerWire(i); });
+    double tickerDecodeJson = nanosPerOp(iterations, [&](size_t) {
+        json update = json::parse(tickerText);
+        sink = update["best_bid_price"].get<double>() + update["best_ask_price"].get<double>() +
+               update["mark_price"].get<double>() + update["open_interest"].get<double>();
+    });
+    double tickerDecodeWire = nanosPerOp(iterations, [&](size_t) {
+        WireMessage update;
+        update.parse(buffer, tickerBytes);
+        WireTicker t = update.body<WireTicker>();
+        sink = fromWirePrice(t.bestBidPrice) + fromWirePrice(t.bestAskPrice) + fromWirePrice(t.markPrice) +
+               t.openInterest;
+    });
+
+    // ---- order event ----
+    auto orderJson = [&](size_t i) {
+        return json{
+            {"type", "order"}, {"instrument", instrument}, {"order_id", order.orderId},
+            {"order_state", order.orderState}, {"direction", "buy"}, {"price", priceOf(i)},
+            {"amount", order.amount}, {"filled_amount", order.filledAmount}, {"timestamp", order.timestamp + i}
+        }.dump();
+    };
+    auto orderWire = [&](size_t i) {
+        order.price = priceOf(i);
+        return encodeWireOrderEvent(buffer, sizeof(buffer), instrumentId, order);
+    };
+    std::string orderText = orderJson(7);
+    size_t orderBytes = orderWire(7);
+    double orderEncodeJson = nanosPerOp(iterations, [&](size_t i) { sink = orderJson(i).size(); });
+    double orderEncodeWire = nanosPerOp(iterations, [&](size_t i) { sink = orderWire(i); });
+    double orderDecodeJson = nanosPerOp(iterations, [&](size_t) {
+        json update = json::parse(orderText);
+        sink = update["price"].get<double>() + update["filled_amount"].get<double>() +
+               update["order_id"].get<std::string>().size() + (update["order_state"] == "open");
+    });
+    double orderDecodeWire = nanosPerOp(iterations, [&](size_t) {
+        WireMessage update;
+        update.parse(buffer, orderBytes);
+        WireOrderEvent event = update.body<WireOrderEvent>();
+        sink = fromWirePrice(event.price) + event.filledAmount + wireText(event.orderId, kWireIdSize).size() +
+               (event.state == static_cast<uint8_t>(WireOrderState::Open));
+    });
+
+    std::cout << iterations << " iterations" << std::endl;
+    std::cout << std::left << std::setw(16) << "message" << std::setw(12) << "json (ns)"
+              << std::setw(12) << "wire (ns)" << std::setw(10) << "speedup" << "bytes (json / wire)" << std::endl;
+    report("book encode", bookEncodeJson, bookEncodeWire, bookText.size(), bookBytes);
+    report("book decode", bookDecodeJson, bookDecodeWire, bookText.size(), bookBytes);
+    report("trade encode", tradeEncodeJson, tradeEncodeWire, tradeText.size(), tradeBytes);
+    report("trade decode", tradeDecodeJson, tradeDecodeWire, tradeText.size(), tradeBytes);
+    report("ticker encode", tickerEncodeJson, tickerEncodeWire, tickerText.size(), tickerBytes);
+    report("ticker decode", tickerDecodeJson, tickerDecodeWire, tickerText.size(), tickerBytes);
+    report("order encode", orderEncodeJson, orderEncodeWire, orderText.size(), orderBytes);
+    report("order decode", orderDecodeJson, orderDecodeWire, orderText.size(), orderBytes);
+    return 0;
+}
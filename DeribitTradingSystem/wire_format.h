@@ -0,0 +1,415 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "order_book.h"
+
+// --------------------------------------------------------------------
+// Binary wire format for downstream market data
+//   Every message is a fixed-layout little-endian struct, a WireHeader
+//   followed by its body; book messages are followed by their levels.
+//   Messages are self-delimiting (header.length), so a buffer or a
+//   WebSocket frame may carry several back to back.
+//
+//   - Prices are fixed-point with 8 decimal places (as in order_book.h),
+//     amounts are IEEE doubles, timestamps are exchange milliseconds.
+//   - Instruments are referred to by a numeric id. An Instrument message
+//     binds an id to a name and precedes any other message using the id.
+//   - Encoding is a memcpy of the struct: no allocation, no formatting,
+//     and the reader copies fields out the same way, so neither side
+//     needs aligned input.
+//   Layout changes must bump kWireVersion; decoders reject other versions.
+// --------------------------------------------------------------------
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "wire structs are encoded in host byte order");
+
+constexpr uint8_t kWireVersion = 1;
+constexpr size_t kWireNameSize = 32;   // instrument names, NUL-padded
+constexpr size_t kWireIdSize = 32;     // trade and order ids, NUL-padded
+// Price of a market order, which has none
+constexpr int64_t kWireNoPrice = std::numeric_limits<int64_t>::min();
+
+enum class WireType : uint8_t {
+    Instrument = 1,
+    BookDelta = 2,
+    BookSnapshot = 3,
+    Trade = 4,
+    Ticker = 5,
+    OrderEvent = 6
+};
+
+// WireHeader::flags
+enum WireFlags : uint16_t {
+    kWireTruncated = 1 << 0   // book holds only the top levels, not the whole book
+};
+
+struct WireHeader {
+    uint32_t length;          // whole message, header and levels included
+    uint8_t version;
+    uint8_t type;             // WireType
+    uint16_t flags;
+    uint32_t instrumentId;
+    uint32_t reserved;
+};
+
+struct WireInstrument {
+    WireHeader header;
+    char name[kWireNameSize];
+};
+
+struct WireLevel {
+    int64_t price;
+    double amount;            // 0 removes the level (deltas only)
+};
+
+// BookDelta and BookSnapshot; followed by bidCount bids (best first in
+// snapshots) and then askCount asks
+struct WireBook {
+    WireHeader header;
+    uint64_t seq;             // update number in the publisher's book
+    int64_t timestamp;
+    int64_t changeId;
+    uint32_t bidCount;
+    uint32_t askCount;
+};
+
+struct WireTrade {
+    WireHeader header;
+    char tradeId[kWireIdSize];
+    int64_t price;
+    double amount;
+    int64_t timestamp;
+    int64_t tradeSeq;
+    uint8_t direction;        // 1 = buy, 2 = sell, 0 = unknown (as TradeDirection)
+    uint8_t padding[7];
+};
+
+struct WireTicker {
+    WireHeader header;
+    int64_t timestamp;
+    int64_t bestBidPrice;
+    double bestBidAmount;
+    int64_t bestAskPrice;
+    double bestAskAmount;
+    int64_t lastPrice;
+    int64_t markPrice;
+    int64_t indexPrice;
+    double openInterest;
+};
+
+enum class WireOrderState : uint8_t {
+    Unknown = 0,
+    Open = 1,
+    Filled = 2,
+    Cancelled = 3,
+    Rejected = 4,
+    Untriggered = 5
+};
+
+struct WireOrderEvent {
+    WireHeader header;
+    char orderId[kWireIdSize];
+    char tradeId[kWireIdSize];  // user.trades events; empty for order updates
+    int64_t price;              // kWireNoPrice for market orders
+    double amount;
+    double filledAmount;
+    int64_t timestamp;
+    uint8_t state;              // WireOrderState
+    uint8_t direction;
+    uint8_t padding[6];
+};
+
+static_assert(sizeof(WireHeader) == 16, "wire layout changed: bump kWireVersion");
+static_assert(sizeof(WireInstrument) == 48, "wire layout changed: bump kWireVersion");
+static_assert(sizeof(WireLevel) == 16, "wire layout changed: bump kWireVersion");
+static_assert(sizeof(WireBook) == 48, "wire layout changed: bump kWireVersion");
+static_assert(sizeof(WireTrade) == 88, "wire layout changed: bump kWireVersion");
+static_assert(sizeof(WireTicker) == 88, "wire layout changed: bump kWireVersion");
+static_assert(sizeof(WireOrderEvent) == 120, "wire layout changed: bump kWireVersion");
+
+constexpr size_t wireBookSize(size_t levelCount) {
+    return sizeof(WireBook) + levelCount * sizeof(WireLevel);
+}
+
+// Fixed-point conversion for the double prices of tickers and orders
+inline int64_t toWirePrice(double price) {
+    return std::isfinite(price) ? toFixedPrice(price) : kWireNoPrice;
+}
+
+inline double fromWirePrice(int64_t price) {
+    return price == kWireNoPrice ? std::nan("") : fromFixedPrice(price);
+}
+
+inline WireOrderState toWireOrderState(std::string_view state) {
+    if (state == "open") return WireOrderState::Open;
+    if (state == "filled") return WireOrderState::Filled;
+    if (state == "cancelled") return WireOrderState::Cancelled;
+    if (state == "rejected") return WireOrderState::Rejected;
+    if (state == "untriggered") return WireOrderState::Untriggered;
+    return WireOrderState::Unknown;
+}
+
+namespace wire_detail {
+
+inline WireHeader header(WireType type, uint32_t instrumentId, size_t length, uint16_t flags = 0) {
+    return WireHeader{static_cast<uint32_t>(length), kWireVersion, static_cast<uint8_t>(type), flags,
+                      instrumentId, 0};
+}
+
+inline void copyText(char* out, size_t size, std::string_view text) {
+    size_t n = std::min(text.size(), size - 1);
+    std::memset(out, 0, size);
+    std::memcpy(out, text.data(), n);
+}
+
+// Deleted levels of a delta go out with amount 0
+inline double levelAmount(const LevelUpdate& level) {
+    return level.action == LevelAction::Delete ? 0.0 : level.amount;
+}
+
+inline double levelAmount(const PriceLevel& level) {
+    return level.amount;
+}
+
+} // namespace wire_detail
+
+// --------------------------------------------------------------------
+// Encoders: each writes one message at 'out' and returns its length, or
+// returns 0 without writing anything if it needs more than 'capacity'
+// bytes. Book encoders keep at most 'maxLevels' per side and set
+// kWireTruncated if that dropped any.
+// --------------------------------------------------------------------
+inline size_t encodeWireInstrument(uint8_t* out, size_t capacity, uint32_t instrumentId, std::string_view name) {
+    WireInstrument message;
+    if (capacity < sizeof(message)) {
+        return 0;
+    }
+    message.header = wire_detail::header(WireType::Instrument, instrumentId, sizeof(message));
+    wire_detail::copyText(message.name, kWireNameSize, name);
+    std::memcpy(out, &message, sizeof(message));
+    return sizeof(message);
+}
+
+// Level is LevelUpdate (a delta) or PriceLevel (a book)
+template <typename Level>
+size_t encodeWireBook(uint8_t* out, size_t capacity, uint32_t instrumentId, bool isSnapshot, uint64_t seq,
+                      int64_t timestamp, int64_t changeId, const Level* bids, size_t bidCount,
+                      const Level* asks, size_t askCount, size_t maxLevels = std::numeric_limits<size_t>::max()) {
+    size_t bidsOut = std::min(bidCount, maxLevels);
+    size_t asksOut = std::min(askCount, maxLevels);
+    size_t length = wireBookSize(bidsOut + asksOut);
+    if (capacity < length) {
+        return 0;
+    }
+    WireBook message;
+    uint16_t flags = bidsOut < bidCount || asksOut < askCount ? kWireTruncated : 0;
+    message.header = wire_detail::header(isSnapshot ? WireType::BookSnapshot : WireType::BookDelta,
+                                         instrumentId, length, flags);
+    message.seq = seq;
+    message.timestamp = timestamp;
+    message.changeId = changeId;
+    message.bidCount = static_cast<uint32_t>(bidsOut);
+    message.askCount = static_cast<uint32_t>(asksOut);
+    std::memcpy(out, &message, sizeof(message));
+
+    uint8_t* p = out + sizeof(message);
+    auto writeLevels = [&](const Level* levels, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            WireLevel level{levels[i].price, wire_detail::levelAmount(levels[i])};
+            std::memcpy(p, &level, sizeof(level));
+            p += sizeof(level);
+        }
+    };
+    writeLevels(bids, bidsOut);
+    writeLevels(asks, asksOut);
+    return length;
+}
+
+inline size_t encodeWireTrade(uint8_t* out, size_t capacity, uint32_t instrumentId, std::string_view tradeId,
+                              int64_t price, double amount, uint8_t direction, int64_t timestamp, int64_t tradeSeq) {
+    WireTrade message;
+    if (capacity < sizeof(message)) {
+        return 0;
+    }
+    message.header = wire_detail::header(WireType::Trade, instrumentId, sizeof(message));
+    wire_detail::copyText(message.tradeId, kWireIdSize, tradeId);
+    message.price = price;
+    message.amount = amount;
+    message.timestamp = timestamp;
+    message.tradeSeq = tradeSeq;
+    message.direction = direction;
+    std::memset(message.padding, 0, sizeof(message.padding));
+    std::memcpy(out, &message, sizeof(message));
+    return sizeof(message);
+}
+
+// 'ticker' is a TickerNotification (or anything with its fields)
+template <typename Ticker>
+size_t encodeWireTicker(uint8_t* out, size_t capacity, uint32_t instrumentId, const Ticker& ticker) {
+    WireTicker message;
+    if (capacity < sizeof(message)) {
+        return 0;
+    }
+    message.header = wire_detail::header(WireType::Ticker, instrumentId, sizeof(message));
+    message.timestamp = ticker.timestamp;
+    message.bestBidPrice = toWirePrice(ticker.bestBidPrice);
+    message.bestBidAmount = ticker.bestBidAmount;
+    message.bestAskPrice = toWirePrice(ticker.bestAskPrice);
+    message.bestAskAmount = ticker.bestAskAmount;
+    message.lastPrice = toWirePrice(ticker.lastPrice);
+    message.markPrice = toWirePrice(ticker.markPrice);
+    message.indexPrice = toWirePrice(ticker.indexPrice);
+    message.openInterest = ticker.openInterest;
+    std::memcpy(out, &message, sizeof(message));
+    return sizeof(message);
+}
+
+// 'event' is an OrderEvent (or anything with its fields)
+template <typename Event>
+size_t encodeWireOrderEvent(uint8_t* out, size_t capacity, uint32_t instrumentId, const Event& event) {
+    WireOrderEvent message;
+    if (capacity < sizeof(message)) {
+        return 0;
+    }
+    message.header = wire_detail::header(WireType::OrderEvent, instrumentId, sizeof(message));
+    wire_detail::copyText(message.orderId, kWireIdSize, event.orderId);
+    wire_detail::copyText(message.tradeId, kWireIdSize, event.tradeId);
+    message.price = toWirePrice(event.price);
+    message.amount = event.amount;
+    message.filledAmount = event.filledAmount;
+    message.timestamp = event.timestamp;
+    message.state = static_cast<uint8_t>(toWireOrderState(event.orderState));
+    message.direction = static_cast<uint8_t>(event.direction);
+    std::memset(message.padding, 0, sizeof(message.padding));
+    std::memcpy(out, &message, sizeof(message));
+    return sizeof(message);
+}
+
+// Appends a message to a growable buffer, e.g. a WebSocket payload:
+//   appendWire(payload, wireBookSize(n), [&](uint8_t* out, size_t cap) { return encodeWireBook(out, cap, ...); });
+template <typename Encode>
+size_t appendWire(std::string& buffer, size_t maxLength, Encode&& encode) {
+    size_t offset = buffer.size();
+    buffer.resize(offset + maxLength);
+    size_t length = encode(reinterpret_cast<uint8_t*>(&buffer[offset]), maxLength);
+    buffer.resize(offset + length);
+    return length;
+}
+
+// --------------------------------------------------------------------
+// WireMessage: a view of one encoded message
+//   const uint8_t* p = data; size_t left = size; WireMessage message;
+//   while (message.parse(p, left)) {
+//       if (message.type() == WireType::Trade) { WireTrade t = message.body<WireTrade>(); ... }
+//       p += message.length(); left -= message.length();
+//   }
+// --------------------------------------------------------------------
+class WireMessage {
+private:
+    const uint8_t* data = nullptr;
+    WireHeader head{};
+
+    static size_t minimumLength(uint8_t type) {
+        switch (static_cast<WireType>(type)) {
+            case WireType::Instrument: return sizeof(WireInstrument);
+            case WireType::BookDelta:
+            case WireType::BookSnapshot: return sizeof(WireBook);
+            case WireType::Trade: return sizeof(WireTrade);
+            case WireType::Ticker: return sizeof(WireTicker);
+            case WireType::OrderEvent: return sizeof(WireOrderEvent);
+        }
+        return sizeof(WireHeader);
+    }
+
+public:
+    // Reads the message at the front of [bytes, bytes + size). False if
+    // it is truncated, malformed or of another version; unknown types
+    // parse (as header only) so newer publishers can add them.
+    bool parse(const void* bytes, size_t size) {
+        data = nullptr;
+        if (size < sizeof(WireHeader)) {
+            return false;
+        }
+        std::memcpy(&head, bytes, sizeof(head));
+        if (head.version != kWireVersion || head.length < minimumLength(head.type) || head.length > size) {
+            return false;
+        }
+        if (head.type == static_cast<uint8_t>(WireType::BookDelta) ||
+            head.type == static_cast<uint8_t>(WireType::BookSnapshot)) {
+            WireBook book;
+            std::memcpy(&book, bytes, sizeof(book));
+            if (head.length != wireBookSize(static_cast<size_t>(book.bidCount) + book.askCount)) {
+                return false;
+            }
+        }
+        data = static_cast<const uint8_t*>(bytes);
+        return true;
+    }
+
+    const WireHeader& header() const { return head; }
+    WireType type() const { return static_cast<WireType>(head.type); }
+    uint32_t instrumentId() const { return head.instrumentId; }
+    size_t length() const { return head.length; }
+
+    // The fixed part of the message, copied out (Body matches type())
+    template <typename Body>
+    Body body() const {
+        static_assert(std::is_trivially_copyable<Body>::value, "wire bodies are plain structs");
+        Body out;
+        std::memcpy(&out, data, sizeof(out));
+        return out;
+    }
+
+    // Book messages: level 'index' of the bids followed by the asks
+    WireLevel level(size_t index) const {
+        WireLevel out;
+        std::memcpy(&out, data + sizeof(WireBook) + index * sizeof(WireLevel), sizeof(out));
+        return out;
+    }
+};
+
+// Text fields are NUL-padded, so a full-length one has no terminator
+inline std::string_view wireText(const char* field, size_t size) {
+    return std::string_view(field, strnlen(field, size));
+}
+
+// --------------------------------------------------------------------
+// InstrumentRegistry: instrument name <-> wire id, assigned from 1 in
+// the order names are first seen. Not thread-safe; each publisher keeps
+// its own and announces ids with Instrument messages.
+// --------------------------------------------------------------------
+class InstrumentRegistry {
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+
+public:
+    uint32_t idOf(const std::string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        names.push_back(name);
+        uint32_t id = static_cast<uint32_t>(names.size());
+        ids.emplace(name, id);
+        return id;
+    }
+
+    // Empty for ids this registry has not assigned
+    std::string_view nameOf(uint32_t id) const {
+        return id >= 1 && id <= names.size() ? std::string_view(names[id - 1]) : std::string_view();
+    }
+
+    size_t size() const { return names.size(); }
+};
+
+#endif // WIRE_FORMAT_H